@@ -0,0 +1,602 @@
+// Microbenchmarks of the INO reconstruction kernels.
+//
+//   bench [number of events] [--out=<file>]
+//
+// Every benchmark reports the wall time and the number of heap
+// allocations per iteration. With --out the results are also written
+// as JSON, or as CSV if the file name ends in .csv, to compare them
+// between commits. It has to be run from a directory containing
+// calibration.db.
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <memory>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "INOEvent.h"
+#include "INOTimeGroupingModule.h"
+#include "INOGausKernel.h"
+#include "INOHitDecoder.h"
+#include "INOAllocationCounter.h"
+#include "INOCalibrationManager.h"
+#include "INOPixelGeometry.h"
+#include "INODetectorConstants.h"
+#include "INOTracking.h"
+#include "INOClustering.h"
+#include "INOEventGenerator.h"
+#include "INOCommandLine.h"
+
+using namespace std;
+
+
+struct BenchmarkResult {
+  std::string name;
+  long        iterations;
+  double      seconds;
+  uint64_t    allocations;
+};
+
+volatile double benchmarkSink = 0; // keeps results alive
+
+
+template <class Body>
+BenchmarkResult runBenchmark(const std::string& name, long iterations, Body&& body) {
+  uint64_t allocationsBefore = INO::getThreadAllocationCount();
+  auto start = std::chrono::steady_clock::now();
+  for (long it = 0; it < iterations; it++)
+    body(it);
+  auto stop = std::chrono::steady_clock::now();
+  uint64_t allocationsAfter = INO::getThreadAllocationCount();
+  return {name, iterations,
+          std::chrono::duration<double>(stop - start).count(),
+          allocationsAfter - allocationsBefore};
+}
+
+
+void printResult(const BenchmarkResult& result) {
+  cout << std::left << std::setw(32) << result.name << std::right
+       << std::setw(10) << result.iterations
+       << std::setw(14) << std::setprecision(4) << 1.e9 * result.seconds / result.iterations << " ns/it"
+       << std::setw(12) << std::setprecision(4) << double(result.allocations) / result.iterations << " alloc/it"
+       << endl;
+}
+
+
+// Results as JSON, or as CSV if fileName ends in .csv
+bool writeResults(const std::vector<BenchmarkResult>& results, const std::string& fileName) {
+  std::ofstream out(fileName);
+  if (!out) {
+    cerr << "Error: cannot write benchmark results " << fileName << endl;
+    return false;
+  }
+  bool isCSV = fileName.size() >= 4 && fileName.compare(fileName.size() - 4, 4, ".csv") == 0;
+  out << std::setprecision(6);
+  if (isCSV)
+    out << "name,iterations,seconds,nsPerIteration,iterationsPerSecond,allocationsPerIteration\n";
+  else
+    out << "{\n  \"benchmarks\": [";
+  for (size_t ij = 0; ij < results.size(); ij++) {
+    const BenchmarkResult& result = results[ij];
+    double nsPerIteration = 1.e9 * result.seconds / result.iterations;
+    double iterationsPerSecond = result.seconds > 0 ? result.iterations / result.seconds : 0;
+    double allocationsPerIteration = double(result.allocations) / result.iterations;
+    if (isCSV)
+      out << "\"" << result.name << "\"," << result.iterations << "," << result.seconds << ","
+          << nsPerIteration << "," << iterationsPerSecond << "," << allocationsPerIteration << "\n";
+    else
+      out << (ij ? "," : "") << "\n    {\"name\": \"" << result.name << "\""
+          << ", \"iterations\": " << result.iterations
+          << ", \"seconds\": " << result.seconds
+          << ", \"nsPerIteration\": " << nsPerIteration
+          << ", \"iterationsPerSecond\": " << iterationsPerSecond
+          << ", \"allocationsPerIteration\": " << allocationsPerIteration << "}";
+  }
+  if (!isCSV) out << "\n  ]\n}\n";
+  return true;
+}
+
+
+// Strips and TDC times of a synthetic event
+struct SyntheticEvent {
+  std::vector<INO::StripId> strips;
+  std::vector<double> leadingTimes;
+};
+
+
+// A cosmic-like event: one strip per layer side along a straight line,
+// sometimes a neighbour, plus a few noise strips.
+SyntheticEvent generateSyntheticEvent(std::mt19937& rng) {
+  std::uniform_real_distribution<double> uniform(0., 1.);
+  std::normal_distribution<double> jitter(0., 2.);
+  SyntheticEvent synthetic;
+  double start[2] = {10 + 44 * uniform(rng), 10 + 44 * uniform(rng)};
+  double slope[2] = {uniform(rng) - 0.5, uniform(rng) - 0.5};
+  for (int layer = 0; layer < INO::nLayers; layer++)
+    for (int side = 0; side < INO::nSides; side++) {
+      int strip = int(start[side] + slope[side] * layer);
+      synthetic.strips.push_back({0, 0, 0, layer, side, strip});
+      if (uniform(rng) < 0.3) synthetic.strips.push_back({0, 0, 0, layer, side, strip + 1});
+      if (uniform(rng) < 0.1) synthetic.strips.push_back({0, 0, 0, layer, side, int(64 * uniform(rng))});
+    }
+  for (size_t ij = 0; ij < synthetic.strips.size(); ij++)
+    synthetic.leadingTimes.push_back(-260. + jitter(rng));
+  return synthetic;
+}
+
+
+void fillEvent(INO::INOEvent& event, const SyntheticEvent& synthetic) {
+  for (size_t ij = 0; ij < synthetic.strips.size(); ij++) {
+    const auto& stripId = synthetic.strips[ij];
+    INO::TDCId tdcId = {0, 0, 0, stripId.layer, stripId.side, stripId.strip % 8};
+    event.addTDC(tdcId, synthetic.leadingTimes[ij], 0);
+    event.addTDC(tdcId, synthetic.leadingTimes[ij] + 20., 1);
+  }
+  for (const auto& stripId : synthetic.strips)
+    event.addHit(stripId);
+}
+
+
+// The SNM arrays of one event, without the TTree
+struct SNMArrays {
+  ULong64_t xydata[2][12];
+  UChar_t   xythit[2][12][8];
+  Int_t     xytime[2][12][8][256];
+  UShort_t  plWidth[2][12][8][256];
+};
+
+
+void fillSNMArrays(SNMArrays& arrays, const SyntheticEvent& synthetic) {
+  std::memset(arrays.xydata, 0, sizeof(arrays.xydata));
+  std::memset(arrays.xythit, 0, sizeof(arrays.xythit));
+  for (size_t ij = 0; ij < synthetic.strips.size(); ij++) {
+    const auto& stripId = synthetic.strips[ij];
+    arrays.xydata[stripId.side][stripId.layer] |= uint64_t(1) << stripId.strip;
+    UChar_t& nTDCHits = arrays.xythit[stripId.side][stripId.layer][stripId.strip % 8];
+    if (nTDCHits >= 4) continue;
+    arrays.xytime[stripId.side][stripId.layer][stripId.strip % 8][nTDCHits] = int(synthetic.leadingTimes[ij] / INO::tdcLeast);
+    arrays.plWidth[stripId.side][stripId.layer][stripId.strip % 8][nTDCHits] = 200;
+    nTDCHits++;
+  }
+}
+
+
+// Decoding as done before the bit scan, every strip bit is tested
+void decodeEventBitLoop(const SNMArrays& arrays, INO::INOEvent& inoEvent, int nLayers, double tdcLeast) {
+  for (int ij = 0; ij < nLayers; ij++)
+    for (int nj = 0; nj < 2; nj++)
+      for (int ntdc = 0; ntdc < 8; ntdc++) {
+        int nTDCHits = arrays.xythit[nj][ij][ntdc];
+        for (int tc = 0; tc < nTDCHits; tc++) {
+          int rawTDCl = arrays.xytime[nj][ij][ntdc][tc] * tdcLeast;
+          int rawTDCt = rawTDCl + arrays.plWidth[nj][ij][ntdc][tc] * tdcLeast;
+          inoEvent.addTDC(INO::TDCId{0, 0, 0, ij, nj, ntdc}, rawTDCl, 0);
+          inoEvent.addTDC(INO::TDCId{0, 0, 0, ij, nj, ntdc}, rawTDCt, 1);
+        }
+      }
+  for (int ij = 0; ij < nLayers; ij++)
+    for (int nj = 0; nj < 2; nj++)
+      for (int kl = 63; kl >= 0; kl--)
+        if ((arrays.xydata[nj][ij] >> kl) & 0x01)
+          inoEvent.addHit(INO::StripId{0, 0, 0, ij, nj, kl});
+}
+
+
+// Gauss deposition as done before the lookup tables, bin by bin with TMath::Gaus
+void addGausWithTMath(INO::INOTimeHistogram& hist, double integral, double center, double sigma, double sigmaN) {
+  int startBin = std::max(1, hist.findBin(center - sigmaN * sigma));
+  int   endBin = std::min(hist.getNBins(), hist.findBin(center + sigmaN * sigma));
+  if (startBin > endBin) return;
+  double* bins = hist.getBinRange(startBin, endBin);
+  for (int ijx = startBin; ijx <= endBin; ijx++)
+    bins[ijx - startBin] += integral * TMath::Gaus(hist.getBinCenter(ijx), center, sigma, true);
+}
+
+
+// Straight line fit of the pixels of an event, as grouping-and-efficiency did before fitLine
+void fitPixels(const std::vector<INO::PixelId>& pixels, const INO::INOPixelGeometry& pixelGeometry,
+               std::vector<TVector3>& ext) {
+  std::vector<TVector3> pos;
+  std::vector<TVector2> poserr;
+  std::vector<bool> occulay;
+  std::vector<TVector3> exterr;
+  TVector2 slope, inter, chi2;
+  for (const auto& pixel : pixels) {
+    pos.push_back(pixelGeometry.getPosition(pixel));
+    poserr.push_back({0.008, 0.008});
+  }
+  INO::LinearVectorFit(0, pos, poserr, occulay, slope, inter, chi2, ext, exterr);
+}
+
+
+int main(int argc, char** argv) {
+
+  auto options = INO::takeOptions(argc, argv, {"out"});
+  long nEvents = argc > 1 ? stol(argv[1]) : 10000;
+
+  std::mt19937 rng(12345);
+  std::vector<SyntheticEvent> syntheticEvents;
+  std::vector<std::shared_ptr<INO::INOEvent>> events;
+  for (long iev = 0; iev < nEvents; iev++) {
+    syntheticEvents.push_back(generateSyntheticEvent(rng));
+    events.push_back(std::make_shared<INO::INOEvent>());
+    fillEvent(*events.back(), syntheticEvents.back());
+    for (const auto& stripId : syntheticEvents.back().strips)
+      events.back()->setTimeGroupId(stripId).push_back(0);
+  }
+
+  std::vector<BenchmarkResult> results;
+
+  // a new event per entry
+  results.push_back(runBenchmark("INOEvent fill (new event)", nEvents, [&](long iev) {
+    auto event = std::make_shared<INO::INOEvent>();
+    fillEvent(*event, syntheticEvents[iev]);
+    benchmarkSink = event->getEntries();
+  }));
+
+  // one event reused for all entries
+  auto pooledEvent = std::make_shared<INO::INOEvent>();
+  results.push_back(runBenchmark("INOEvent fill (reset)", nEvents, [&](long iev) {
+    pooledEvent->reset();
+    fillEvent(*pooledEvent, syntheticEvents[iev]);
+    benchmarkSink = pooledEvent->getEntries();
+  }));
+
+  // addTDC alone, addHit is the difference to the fill above
+  results.push_back(runBenchmark("INOEvent::addTDC", nEvents, [&](long iev) {
+    pooledEvent->reset();
+    for (size_t ij = 0; ij < syntheticEvents[iev].strips.size(); ij++) {
+      const auto& stripId = syntheticEvents[iev].strips[ij];
+      INO::TDCId tdcId = {0, 0, 0, stripId.layer, stripId.side, stripId.strip % 8};
+      pooledEvent->addTDC(tdcId, syntheticEvents[iev].leadingTimes[ij], 0);
+      pooledEvent->addTDC(tdcId, syntheticEvents[iev].leadingTimes[ij] + 20., 1);
+    }
+    benchmarkSink = pooledEvent->getEntries();
+  }));
+
+  // calibration lookups, the strip delays come from the in-memory cache
+  INO::INOCalibrationManager& calibration = INO::INOCalibrationManager::getInstance();
+  results.push_back(runBenchmark("getStripTimeDelay", nEvents, [&](long iev) {
+    double sum = 0;
+    for (const auto& stripId : syntheticEvents[iev].strips)
+      sum += calibration.getStripTimeDelay(stripId);
+    benchmarkSink = sum;
+  }));
+  results.push_back(runBenchmark("getLayerPosition", std::min(nEvents, 2000L), [&](long iev) {
+    TVector3 position, orientation;
+    calibration.getLayerPosition({0, 0, 0, int(iev % INO::nLayers)}, iev & 1, (iev >> 1) & 1,
+                                 position, orientation);
+    benchmarkSink = position.X();
+  }));
+
+  // hit access as done before the view API: every call returns a copy
+  results.push_back(runBenchmark("INOEvent access (copies)", nEvents, [&](long iev) {
+    const INO::INOEvent& event = *events[iev];
+    double sum = 0;
+    std::vector<const INO::Hit*> hits = event.getHits();
+    for (const auto* hit : hits) {
+      std::vector<double> times = event.getCalibratedLeadingTimes(hit->stripId);
+      std::vector<int> groupIds = event.getTimeGroupId(hit->stripId);
+      if (!times.empty() && !groupIds.empty()) sum += times[0] + groupIds[0];
+    }
+    benchmarkSink = sum;
+  }));
+
+  // the same access through the non-copying views
+  results.push_back(runBenchmark("INOEvent access (views)", nEvents, [&](long iev) {
+    const INO::INOEvent& event = *events[iev];
+    double sum = 0;
+    for (const auto& hit : event.getHitRange()) {
+      const auto& times = event.getCalibratedLeadingTimes(hit.stripId);
+      const auto& groupIds = event.getTimeGroupId(hit.stripId);
+      if (!times.empty() && !groupIds.empty()) sum += times[0] + groupIds[0];
+    }
+    benchmarkSink = sum;
+  }));
+
+  // full time grouping, the event and the module are reused
+  INO::INOTimeGroupingModule inoTimeGrouping(pooledEvent);
+  results.push_back(runBenchmark("INOTimeGroupingModule::process", nEvents, [&](long iev) {
+    pooledEvent->reset();
+    fillEvent(*pooledEvent, syntheticEvents[iev]);
+    inoTimeGrouping.process();
+  }));
+
+  // the same with the sort-and-sweep engine
+  INO::INOTimeGroupingModule sweepTimeGrouping(pooledEvent);
+  INO::TimeGroupingParameters sweepPars = sweepTimeGrouping.getParameters();
+  sweepPars.groupingEngine = INO::c_sortAndSweep;
+  sweepTimeGrouping.setParameters(sweepPars);
+  results.push_back(runBenchmark("INOTimeGroupingModule (sweep)", nEvents, [&](long iev) {
+    pooledEvent->reset();
+    fillEvent(*pooledEvent, syntheticEvents[iev]);
+    sweepTimeGrouping.process();
+  }));
+
+  // the same on clusters of adjacent strips
+  INO::INOTimeGroupingModule clusterTimeGrouping(pooledEvent);
+  INO::TimeGroupingParameters clusterPars = clusterTimeGrouping.getParameters();
+  clusterPars.useStripClusters = true;
+  clusterTimeGrouping.setParameters(clusterPars);
+  results.push_back(runBenchmark("INOTimeGroupingModule (clusters)", nEvents, [&](long iev) {
+    pooledEvent->reset();
+    fillEvent(*pooledEvent, syntheticEvents[iev]);
+    clusterTimeGrouping.process();
+  }));
+
+  // decoding of the SNM arrays, a few events are cycled to stay in cache like a real entry
+  const long nSNMEvents = std::min(nEvents, 64L);
+  std::vector<SNMArrays> snmEvents(nSNMEvents);
+  for (long iev = 0; iev < nSNMEvents; iev++)
+    fillSNMArrays(snmEvents[iev], syntheticEvents[iev]);
+
+  results.push_back(runBenchmark("strip scan (bit loop)", nEvents, [&](long iev) {
+    const SNMArrays& arrays = snmEvents[iev % nSNMEvents];
+    int sum = 0;
+    for (int ij = 0; ij < INO::nLayers; ij++)
+      for (int nj = 0; nj < 2; nj++)
+        for (int kl = 63; kl >= 0; kl--)
+          if ((arrays.xydata[nj][ij] >> kl) & 0x01) sum += kl;
+    benchmarkSink = sum;
+  }));
+  results.push_back(runBenchmark("strip scan (bit scan)", nEvents, [&](long iev) {
+    const SNMArrays& arrays = snmEvents[iev % nSNMEvents];
+    int sum = 0;
+    for (int ij = 0; ij < INO::nLayers; ij++)
+      for (int nj = 0; nj < 2; nj++)
+        INO::forEachSetBit(arrays.xydata[nj][ij], [&](int kl) { sum += kl; });
+    benchmarkSink = sum;
+  }));
+  results.push_back(runBenchmark("decode (bit loop)", nEvents, [&](long iev) {
+    pooledEvent->reset();
+    decodeEventBitLoop(snmEvents[iev % nSNMEvents], *pooledEvent, INO::nLayers, INO::tdcLeast);
+    benchmarkSink = pooledEvent->getEntries();
+  }));
+  results.push_back(runBenchmark("decode (INO::decodeEvent)", nEvents, [&](long iev) {
+    pooledEvent->reset();
+    INO::decodeEvent(snmEvents[iev % nSNMEvents], *pooledEvent, INO::nLayers, INO::tdcLeast);
+    benchmarkSink = pooledEvent->getEntries();
+  }));
+
+  // pixel combinatorics and the straight line fit, all strips are in group 0
+  INO::INOPixelGeometry pixelGeometry(INO::stripWidth, INO::layerPitch, 0.);
+  std::vector<INO::PixelId> pixels;
+  results.push_back(runBenchmark("formPixels", nEvents, [&](long iev) {
+    pixels.clear();
+    INO::formPixels(*events[iev], pixels);
+    benchmarkSink = pixels.size();
+  }));
+
+  std::vector<INO::StripCluster> clusters;
+  results.push_back(runBenchmark("findClusters", nEvents, [&](long iev) {
+    INO::findClusters(*events[iev], clusters);
+    benchmarkSink = clusters.size();
+  }));
+  results.push_back(runBenchmark("formClusterPixels", nEvents, [&](long iev) {
+    INO::findClusters(*events[iev], clusters);
+    pixels.clear();
+    INO::formClusterPixels(*events[iev], clusters, pixels);
+    benchmarkSink = pixels.size();
+  }));
+
+  std::vector<std::vector<INO::PixelId>> eventPixels(nEvents);
+  for (long iev = 0; iev < nEvents; iev++)
+    INO::formPixels(*events[iev], eventPixels[iev]);
+  std::vector<TVector3> ext;
+  results.push_back(runBenchmark("LinearVectorFit", nEvents, [&](long iev) {
+    fitPixels(eventPixels[iev], pixelGeometry, ext);
+    benchmarkSink = ext.empty() ? 0 : ext[0].X();
+  }));
+
+  INO::LineFitBuffer fitPoints;
+  INO::LineFitResult fit;
+  results.push_back(runBenchmark("fitLine", nEvents, [&](long iev) {
+    fitPoints.clear();
+    for (const auto& pixel : eventPixels[iev])
+      fitPoints.add(pixelGeometry.getPosition(pixel), 0.008, 0.008);
+    INO::fitLine(0, fitPoints.getPoints(), fit);
+    benchmarkSink = fit.getValue(0, fitPoints.z.empty() ? 0. : fitPoints.z[0]);
+  }));
+
+  // tracks of one point per layer, the first pixel of each layer of an event, one by one and in batches
+  std::vector<std::vector<INO::PixelId>> eventTracks(nEvents);
+  for (long iev = 0; iev < nEvents; iev++) {
+    unsigned layers = 0;
+    for (const auto& pixel : eventPixels[iev])
+      if (!((layers >> pixel.layer) & 1)) {
+        layers |= 1u << pixel.layer;
+        eventTracks[iev].push_back(pixel);
+      }
+  }
+  results.push_back(runBenchmark("fitLine (one point per layer)", nEvents, [&](long iev) {
+    fitPoints.clear();
+    for (const auto& pixel : eventTracks[iev])
+      fitPoints.add(pixelGeometry.getPosition(pixel), 0.008, 0.008);
+    INO::fitLine(0, fitPoints.getPoints(), fit);
+    benchmarkSink = fit.slope[0];
+  }));
+  INO::LineFitBatch batch;
+  const int batchWidth = INO::LineFitBatch::width;
+  results.push_back(runBenchmark("fitLines (one point per layer, per track)", (nEvents / batchWidth) * batchWidth,
+                                 [&](long iev) {
+    int track = iev % batchWidth;
+    if (track == 0) batch.reset();
+    for (const auto& pixel : eventTracks[iev])
+      batch.setPoint(track, pixel.layer, pixelGeometry.getPosition(pixel), 0.008, 0.008);
+    if (track == batchWidth - 1) {
+      INO::fitLines(0, batch);
+      benchmarkSink = batch.slope[0][0];
+    }
+  }));
+
+  // the fit without each layer in turn, for unbiased residuals: one fit per layer or one set of sums
+  results.push_back(runBenchmark("leave-one-out (LinearVectorFit per layer)", nEvents, [&](long iev) {
+    std::vector<TVector3> pos, ext, exterr;
+    std::vector<TVector2> poserr;
+    std::vector<bool> occulay;
+    TVector2 slope, inter, chi2;
+    for (const auto& pixel : eventPixels[iev]) {
+      pos.push_back(pixelGeometry.getPosition(pixel));
+      poserr.push_back({0.008, 0.008});
+    }
+    double sum = 0;
+    for (int layer = 0; layer < INO::nLayers; layer++) {
+      occulay.clear();
+      for (const auto& pixel : eventPixels[iev]) occulay.push_back(pixel.layer != layer);
+      INO::LinearVectorFit(0, pos, poserr, occulay, slope, inter, chi2, ext, exterr);
+      sum += slope.X();
+    }
+    benchmarkSink = sum;
+  }));
+  results.push_back(runBenchmark("leave-one-out (LinearFitSums)", nEvents, [&](long iev) {
+    INO::LinearFitSums sums;
+    for (const auto& pixel : eventPixels[iev]) {
+      TVector3 point = pixelGeometry.getPosition(pixel);
+      for (int nj = 0; nj < INO::nSides; nj++) sums.add(nj, point.Z(), point[nj], 0.008);
+    }
+    double sum = 0;
+    for (int layer = 0; layer < INO::nLayers; layer++) {
+      INO::LinearFitSums layerSums = sums;
+      for (const auto& pixel : eventPixels[iev]) {
+        if (pixel.layer != layer) continue;
+        TVector3 point = pixelGeometry.getPosition(pixel);
+        for (int nj = 0; nj < INO::nSides; nj++) layerSums.remove(nj, point.Z(), point[nj], 0.008);
+      }
+      double slope, inter;
+      if (layerSums.getLine(0, slope, inter)) sum += slope;
+    }
+    benchmarkSink = sum;
+  }));
+
+  // filling the time histogram of an event, 3 ns gauss up to 7 sigma on 1 ns bins
+  double clsSigma = 3., fillSigmaN = 7.;
+  INO::INOTimeHistogram timeHistogram;
+  auto resetTimeHistogram = [&](long iev) {
+    const auto& times = syntheticEvents[iev].leadingTimes;
+    double low = *std::min_element(times.begin(), times.end()) - 100.;
+    int nBin = int(*std::max_element(times.begin(), times.end()) + 100. - low);
+    timeHistogram.reset(nBin, low, low + nBin);
+  };
+
+  TH1D timeTH1D("h_benchTime", "h_benchTime", 1, 0., 1.);
+  timeTH1D.SetDirectory(0);
+  results.push_back(runBenchmark("gauss fill (TH1D)", nEvents, [&](long iev) {
+    const auto& times = syntheticEvents[iev].leadingTimes;
+    double low = *std::min_element(times.begin(), times.end()) - 100.;
+    int nBin = int(*std::max_element(times.begin(), times.end()) + 100. - low);
+    timeTH1D.Reset();
+    timeTH1D.SetBins(nBin, low, low + nBin);
+    for (double time : times)
+      INO::addGausToHistogram(timeTH1D, 1., time, clsSigma, fillSigmaN);
+    benchmarkSink = timeTH1D.GetBinContent(nBin / 2);
+  }));
+
+  results.push_back(runBenchmark("gauss fill (TMath::Gaus)", nEvents, [&](long iev) {
+    resetTimeHistogram(iev);
+    for (double time : syntheticEvents[iev].leadingTimes)
+      addGausWithTMath(timeHistogram, 1., time, clsSigma, fillSigmaN);
+    benchmarkSink = timeHistogram.getBinContent(timeHistogram.getNBins() / 2);
+  }));
+
+  results.push_back(runBenchmark("gauss fill (unit table)", nEvents, [&](long iev) {
+    resetTimeHistogram(iev);
+    for (double time : syntheticEvents[iev].leadingTimes)
+      INO::addGausToHistogram(timeHistogram, 1., time, clsSigma, fillSigmaN);
+    benchmarkSink = timeHistogram.getBinContent(timeHistogram.getNBins() / 2);
+  }));
+
+  INO::INOGausKernel fillKernel;
+  fillKernel.configure(clsSigma, 1., fillSigmaN);
+  results.push_back(runBenchmark("gauss fill (kernel)", nEvents, [&](long iev) {
+    resetTimeHistogram(iev);
+    for (double time : syntheticEvents[iev].leadingTimes)
+      fillKernel.add(timeHistogram, 1., time);
+    benchmarkSink = timeHistogram.getBinContent(timeHistogram.getNBins() / 2);
+  }));
+
+  // removal of a fitted gauss, sigma changes from peak to peak
+  std::uniform_real_distribution<double> fittedSigma(1., 20.);
+  std::vector<double> removalSigmas;
+  for (long iev = 0; iev < nEvents; iev++)
+    removalSigmas.push_back(fittedSigma(rng));
+  resetTimeHistogram(0);
+  results.push_back(runBenchmark("gauss removal (TMath::Gaus)", nEvents, [&](long iev) {
+    addGausWithTMath(timeHistogram, -1., -260., removalSigmas[iev], fillSigmaN);
+  }));
+  results.push_back(runBenchmark("gauss removal (unit table)", nEvents, [&](long iev) {
+    INO::subtractGausFromHistogram(timeHistogram, 1., -260., removalSigmas[iev], fillSigmaN);
+  }));
+
+  // end to end as in grouping-and-efficiency: decoding, time grouping, pixels and fit of
+  // generated events at two noise levels, a few events are cycled as above
+  for (double noiseStrips : {0.5, 5.}) {
+    INO::INOEventGenerator::Parameters generatorPars;
+    generatorPars.noiseStrips = noiseStrips;
+    generatorPars.seed = 12345;
+    INO::INOEventGenerator generator(generatorPars);
+    std::vector<std::unique_ptr<INO::RawEvent>> rawEvents;
+    INO::INOEventGenerator::Truth truth;
+    for (long iev = 0; iev < nSNMEvents; iev++) {
+      rawEvents.emplace_back(new INO::RawEvent());
+      generator.generate(*rawEvents.back(), truth);
+    }
+    std::string name = noiseStrips < 1 ? "end-to-end (low noise)" : "end-to-end (high noise)";
+    results.push_back(runBenchmark(name, nEvents, [&](long iev) {
+      pooledEvent->reset();
+      INO::decodeEvent(*rawEvents[iev % nSNMEvents], *pooledEvent, INO::nLayers, INO::tdcLeast);
+      inoTimeGrouping.process();
+      pixels.clear();
+      if (INO::formPixels(*pooledEvent, pixels)) fitPixels(pixels, pixelGeometry, ext);
+      benchmarkSink = pixels.size();
+    }));
+    // the same with the pixels of the found track in the fit
+    std::vector<INO::PixelId> trackPixels;
+    results.push_back(runBenchmark(name.substr(0, name.size() - 1) + ", found track)", nEvents, [&](long iev) {
+      pooledEvent->reset();
+      INO::decodeEvent(*rawEvents[iev % nSNMEvents], *pooledEvent, INO::nLayers, INO::tdcLeast);
+      inoTimeGrouping.process();
+      pixels.clear();
+      if (INO::formPixels(*pooledEvent, pixels) &&
+          INO::findTrack(pixels, pixelGeometry, INO::TrackFindingParameters(), trackPixels)) {
+        fitPoints.clear();
+        for (const auto& pixel : trackPixels)
+          fitPoints.add(pixelGeometry.getPosition(pixel), 0.008, 0.008);
+        INO::fitLine(0, fitPoints.getPoints(), fit);
+      }
+      benchmarkSink = trackPixels.size();
+    }));
+  }
+
+  for (const auto& result : results)
+    printResult(result);
+  if (options.count("out") && !writeResults(results, options["out"])) return 1;
+
+  // largest difference of the tables to TMath::Gaus, relative to the gauss maximum
+  double maxKernelDiff = 0, maxUnitDiff = 0;
+  INO::INOTimeHistogram reference, kernelHistogram, unitHistogram;
+  std::uniform_real_distribution<double> center(-300., -200.);
+  for (int ij = 0; ij < 1000; ij++) {
+    double time = center(rng);
+    reference.reset(200, -350., -150.);
+    kernelHistogram.reset(200, -350., -150.);
+    unitHistogram.reset(200, -350., -150.);
+    addGausWithTMath(reference, 1., time, clsSigma, fillSigmaN);
+    fillKernel.add(kernelHistogram, 1., time);
+    INO::addGausToHistogram(unitHistogram, 1., time, clsSigma, fillSigmaN);
+    for (int bin = 1; bin <= 200; bin++) {
+      maxKernelDiff = std::max(maxKernelDiff, std::fabs(kernelHistogram.getBinContent(bin) - reference.getBinContent(bin)));
+      maxUnitDiff   = std::max(maxUnitDiff,   std::fabs(unitHistogram.getBinContent(bin) - reference.getBinContent(bin)));
+    }
+  }
+  double gausMaximum = 1. / (2.50662827 * clsSigma);
+  cout << "max relative deviation from TMath::Gaus: kernel " << maxKernelDiff / gausMaximum
+       << ", unit table " << maxUnitDiff / gausMaximum << endl;
+
+  return 0;
+}
@@ -0,0 +1,43 @@
+// Convert the SNM tree of a ROOT file to a compact hit file, see
+// INOCompactHitFile.h. grouping-and-efficiency and time-alignment read
+// either format.
+//
+//   convert-to-compact <input SNM file> <output compact file>
+
+#include <iostream>
+#include <memory>
+#include <ctime>
+
+#include "INOEventSource.h"
+#include "INOCompactHitFile.h"
+
+using namespace std;
+
+
+int main(int argc, char** argv) {
+
+  if (argc < 3) {
+    cout << "usage: " << argv[0] << " <input SNM file> <output compact file>" << endl;
+    return 1;
+  }
+
+  INO::INOSNMEventSource eventSource(argv[1]);
+  if (!eventSource.isOpen()) return 1;
+  INO::INOCompactHitWriter writer(argv[2]);
+
+  clock_t start_s = clock();
+  int64_t nentry = eventSource.getEntries();
+  for (int64_t iev = 0; iev < nentry; iev++) {
+    if (iev % 100000 == 0)
+      cout << " iev " << iev << " time " << (clock() - start_s) / double(CLOCKS_PER_SEC) << endl;
+    if (!eventSource.readEntry(iev)) {
+      cerr << "Error: cannot read entry " << iev << endl;
+      return 1;
+    }
+    writer.addEvent(eventSource.getEvent());
+  }
+
+  if (!writer.close()) return 1;
+  cout << " converted " << nentry << " events to " << argv[2] << endl;
+  return 0;
+}
@@ -8,6 +8,7 @@
 
 #include "EventLoaderINO.h"
 #include <cstdio>  // For sscanf
+#include <cstdint>
 
 namespace corryvreckan {
 
@@ -76,18 +77,22 @@ namespace corryvreckan {
     int l;
     if (std::sscanf(detectorID.c_str(), "RPC%d", &l) == 1) {
       std::vector<int> strips[2];
-      for(int nj=0;nj<2;nj++)
-        for(int kl=64-1; kl>=0; kl--)
-          if((m_event->xydata[nj][l]>>kl)&0x01) {
-            if (kl < m_detectorRegion[nj][0] || kl > m_detectorRegion[nj][1]) continue;
-            int ntdc = kl % 8;
-            int nTDCHits = m_event->xythit[nj][l][ntdc];
-            time = nTDCHits ? m_event->xytime[nj][l][ntdc][0] * 0.1 : - 1000.0;
-            double adjustedTime = time + m_timestampShift;
-            if (adjustedTime < - 0.5 * m_eventLength ||
-                adjustedTime >   0.5 * m_eventLength) continue;
-            strips[nj].push_back(kl);
-          }
+      for(int nj=0;nj<2;nj++) {
+        // visit only the set bits, highest strip first as before
+        uint64_t bits = m_event->xydata[nj][l];
+        while(bits) {
+          int kl = 63 - __builtin_clzll(bits);
+          bits &= ~(uint64_t(1) << kl);
+          if (kl < m_detectorRegion[nj][0] || kl > m_detectorRegion[nj][1]) continue;
+          int ntdc = kl % 8;
+          int nTDCHits = m_event->xythit[nj][l][ntdc];
+          time = nTDCHits ? m_event->xytime[nj][l][ntdc][0] * 0.1 : - 1000.0;
+          double adjustedTime = time + m_timestampShift;
+          if (adjustedTime < - 0.5 * m_eventLength ||
+              adjustedTime >   0.5 * m_eventLength) continue;
+          strips[nj].push_back(kl);
+        }
+      }
 
       if (!int(strips[0].size()) || !int(strips[1].size())) {
         if(!clipboard->isEventDefined()) {
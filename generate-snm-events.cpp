@@ -0,0 +1,125 @@
+// Generate synthetic cosmic-muon events in the SNM tree format, see
+// INOEventGenerator.h, as input for benchmarks and as ground truth for
+// the efficiency and calibration code. The true muons are written to
+// the tree "Truth" of the same file, entry by entry.
+//
+//   generate-snm-events <output file> <number of events> [options]
+//
+//   --seed=N                    random seed
+//   --noise=N                   mean number of noise strips per layer side
+//   --cluster-probability=P     probability to fire each next neighbour strip
+//   --time-resolution=NS        sigma of the strip times
+//   --efficiency=E|E0,..,E9     efficiency of all layers, or of each layer
+//   --rate=HZ                   mean trigger rate
+//   --max-zenith=RAD            largest zenith angle
+//
+// The strip delays are taken from calibration.db in the current directory.
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <memory>
+#include <ctime>
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TString.h"
+
+#include "INOEventGenerator.h"
+#include "INOCommandLine.h"
+
+using namespace std;
+
+
+/** Add the branches of the SNM tree, as read by SNM::Init, for event */
+void branchSNMTree(TTree* tree, INO::RawEvent& event) {
+  const char* sideMark[2] = {"x", "y"};
+  tree->Branch("nevt", &event.nevt, "nevt/l");
+  tree->Branch("evetime", event.evetime, TString::Format("evetime[%i]/D", INO::nRawLayers));
+  tree->Branch("xydata", event.xydata, TString::Format("xydata[%i][%i]/l", INO::nRawSides, INO::nRawLayers));
+  for (int nj = 0; nj < INO::nRawSides; nj++)
+    for (int ij = 0; ij < INO::nRawLayers; ij++)
+      for (int jk = 0; jk < INO::nRawTDCs; jk++) {
+        TString hitName = TString::Format("xythit_%s_l%i_%i", sideMark[nj], ij, jk);
+        tree->Branch(hitName, &event.xythit[nj][ij][jk], TString::Format("%s/b", hitName.Data()));
+        tree->Branch(TString::Format("xytime_%s_l%i_%i", sideMark[nj], ij, jk), event.xytime[nj][ij][jk],
+                     TString::Format("xytime_%s_l%i_%i[%s]/I", sideMark[nj], ij, jk, hitName.Data()));
+        tree->Branch(TString::Format("plWidth_%s_l%i_%i", sideMark[nj], ij, jk), event.plWidth[nj][ij][jk],
+                     TString::Format("plWidth_%s_l%i_%i[%s]/s", sideMark[nj], ij, jk, hitName.Data()));
+      }
+}
+
+
+/** Add the branches of the truth tree for truth */
+void branchTruthTree(TTree* tree, INO::INOEventGenerator::Truth& truth) {
+  tree->Branch("nevt", &truth.nevt, "nevt/l");
+  tree->Branch("x0", &truth.x0, "x0/D");
+  tree->Branch("y0", &truth.y0, "y0/D");
+  tree->Branch("slopeX", &truth.slopeX, "slopeX/D");
+  tree->Branch("slopeY", &truth.slopeY, "slopeY/D");
+  tree->Branch("time", &truth.time, "time/D");
+  tree->Branch("efficientLayers", &truth.efficientLayers, "efficientLayers/i");
+  tree->Branch("crossedLayers", &truth.crossedLayers, "crossedLayers/i");
+  tree->Branch("strip", truth.strip, TString::Format("strip[%i][%i]/I", INO::nSides, INO::nLayers));
+  tree->Branch("nNoiseStrips", &truth.nNoiseStrips, "nNoiseStrips/I");
+}
+
+
+int main(int argc, char** argv) {
+
+  auto options = INO::takeOptions(argc, argv, {"seed", "noise", "cluster-probability", "time-resolution",
+                                                "efficiency", "rate", "max-zenith"});
+  if (argc < 3) {
+    cout << "usage: " << argv[0] << " <output file> <number of events> [--seed=N] [--noise=N]"
+         << " [--cluster-probability=P] [--time-resolution=NS] [--efficiency=E|E0,..,E9]"
+         << " [--rate=HZ] [--max-zenith=RAD]" << endl;
+    return 1;
+  }
+  int64_t nEvents = std::stoll(argv[2]);
+
+  INO::INOEventGenerator::Parameters pars;
+  pars.seed = INO::getIntOption(options, "seed", pars.seed);
+  pars.noiseStrips = INO::getDoubleOption(options, "noise", pars.noiseStrips);
+  pars.clusterProbability = INO::getDoubleOption(options, "cluster-probability", pars.clusterProbability);
+  pars.timeResolution = INO::getDoubleOption(options, "time-resolution", pars.timeResolution);
+  pars.eventRate = INO::getDoubleOption(options, "rate", pars.eventRate);
+  pars.maxZenith = INO::getDoubleOption(options, "max-zenith", pars.maxZenith);
+  if (options.count("efficiency")) {
+    std::vector<double> efficiencies = INO::getDoubleListOption(options, "efficiency", {});
+    if (efficiencies.size() == 1) efficiencies.resize(INO::nLayers, efficiencies[0]);
+    if (efficiencies.size() != size_t(INO::nLayers)) {
+      cerr << "Error: --efficiency needs 1 or " << INO::nLayers << " values" << endl;
+      return 1;
+    }
+    pars.layerEfficiency = efficiencies;
+  }
+
+  TFile* fileOut = TFile::Open(argv[1], "RECREATE");
+  if (!fileOut || fileOut->IsZombie()) {
+    cerr << "Error: cannot create " << argv[1] << endl;
+    return 1;
+  }
+  std::unique_ptr<INO::RawEvent> event(new INO::RawEvent());
+  INO::INOEventGenerator::Truth truth;
+  TTree* snmTree = new TTree("SNM", "synthetic cosmic muons");
+  TTree* truthTree = new TTree("Truth", "true muons of the SNM tree");
+  branchSNMTree(snmTree, *event);
+  branchTruthTree(truthTree, truth);
+
+  INO::INOEventGenerator generator(pars);
+  clock_t start_s = clock();
+  for (int64_t iev = 0; iev < nEvents; iev++) {
+    if (iev % 100000 == 0)
+      cout << " iev " << iev << " time " << (clock() - start_s) / double(CLOCKS_PER_SEC) << endl;
+    generator.generate(*event, truth);
+    snmTree->Fill();
+    truthTree->Fill();
+  }
+
+  fileOut->cd();
+  snmTree->Write();
+  truthTree->Write();
+  fileOut->Close();
+  cout << " generated " << nEvents << " events in " << argv[1] << endl;
+  return 0;
+}
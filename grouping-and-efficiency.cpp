@@ -11,6 +11,9 @@
 #include <memory>
 #include <csignal>
 #include <algorithm>
+#include <atomic>
+#include <thread>
+#include <chrono>
 
 #include "TTimeStamp.h"
 #include "TH1.h"
@@ -31,11 +34,25 @@
 #include "TGraph.h"
 #include "TMinuit.h"
 #include "TF1.h"
-
-#include "SNM.h"
+#include "TROOT.h"
+#include "Math/MinimizerOptions.h"
+
+#include "INOEventSource.h"
+#include "INOPrefetchingEventSource.h"
+#include "INOCommandLine.h"
+#include "INOWorkScheduler.h"
+#include "INOBoundedQueue.h"
 #include "INOEvent.h"
+#include "INOHitDecoder.h"
 #include "INOStorageManager.h"
+#include "INOPixelGeometry.h"
+#include "INODetectorConstants.h"
+#include "INOTracking.h"
+#include "INOClustering.h"
+#include "INOEfficiencyAccumulator.h"
 #include "INOTimeGroupingModule.h"
+#include "INOAllocationCounter.h"
+#include "INOInstrumentation.h"
 // #include "DynamicHistogram.h"
 #include "INOHelperFunctions.h"
 
@@ -53,11 +70,11 @@ const int        nside         =   2;
 const int        nlayer        =  10;
 const int        nstrip        =  64;
 const int        nTDC          =   8;
-const double     tdc_least     =   0.1;	 // in ns
-const double     stripwidth     =   0.03; // in m
+const double     tdc_least     =   INO::tdcLeast;	 // in ns
+const double     stripwidth     =   INO::stripWidth; // in m
 
 const double     maxtime       =  22.e3;      // in ns
-const double     spdl_mpns      =   0.2;	      // m/ns
+const double     spdl_mpns      =   INO::stripSignalSpeed; // m/ns
 const double     cval_mpns     =   0.29979;   // light speed in m/ns
 const double     cval_mps      =   0.29979e9; /* light speed in m/s */
 
@@ -67,8 +84,8 @@ const double     ironDensity   = 7.86;	 /* in g/cm3 */
 
 
 const double   gapThickness      = 0.008; // 
-const double   ironThickness     = 0.056; // 
-const double   airGap            = 0.045; //
+const double   ironThickness     = INO::ironThickness; // 
+const double   airGap            = INO::airGap; //
 const double   rpcZShift         = 0; //
 // const double   rpcXdistance      = 2.;	  // 
 // const double   rpcYdistance      = 2.1;	  // 
@@ -88,120 +105,620 @@ int getILayer(const double& layer) {
 };
 
 
-void LinearVectorFit(bool              isTime, // time iter
-                     std::vector<TVector3>  pos,
-                     std::vector<TVector2>  poserr,
-                     std::vector<bool>      occulay,
-                     TVector2         &slope,
-                     TVector2         &inter,
-                     TVector2         &chi2,
-                     std::vector<TVector3> &ext,
-                     std::vector<TVector3> &exterr) {
-
-  double szxy[nside] = {0};
-  double   sz[nside] = {0};
-  double  sxy[nside] = {0};
-  double   sn[nside] = {0};
-  double  sz2[nside] = {0};
-
-  double     slp[nside] = {-10000,-10000};
-  double  tmpslp[nside] = {-10000,-10000};
-  double intersect[nside] = {-10000,-10000};
-  double    errcst[nside] = {-10000,-10000};
-  double    errcov[nside] = {-10000,-10000};
-  double    errlin[nside] = {-10000,-10000};
-
-  for(int ij=0;ij<int(pos.size());ij++) {
-    if(int(occulay.size()) && !occulay[ij]) {continue;}
-    // cout << " ij " << ij << endl;
-    double xyzval[3] = {pos[ij].X(),
-                        pos[ij].Y(),
-                        pos[ij].Z()};
-    double xyerr[2]  = {poserr[ij].X(),
-                        poserr[ij].Y()};
-    for(int nj=0;nj<nside;nj++) {
-      szxy[nj] += xyzval[2]*xyzval[nj]/xyerr[nj];
-      sz[nj]   += xyzval[2]/xyerr[nj];
-      sz2[nj]  += xyzval[2]*xyzval[2]/xyerr[nj];
-      sxy[nj]  += xyzval[nj]/xyerr[nj];
-      sn[nj]   += 1/xyerr[nj];
-    }   // for(int nj=0;nj<nside;nj++) {
-  } // for(int ij=0;ij<int(pos.size());ij++){
-  
-  for(int nj=0;nj<nside;nj++) {
-    if(sn[nj]>0. && sz2[nj]*sn[nj] - sz[nj]*sz[nj] !=0.) { 
-      slp[nj] = (szxy[nj]*sn[nj] -
-                 sz[nj]*sxy[nj])/(sz2[nj]*sn[nj] - sz[nj]*sz[nj]);
-      tmpslp[nj] = slp[nj]; 
-      if(isTime) { //time offset correction
-        // if(fabs((cval*1.e-9)*slope+1)<3.30) { 
-        tmpslp[nj] = -1./cval_mps;
-        // }
+/** Layers under test and track selection of the efficiency, set before the workers start */
+INO::EfficiencyParameters efficiencyParameters;
+/** Track finding before the fit, or all pixels in the fit with --all-pixels */
+INO::TrackFindingParameters trackFindingParameters;
+bool isFitAllPixels = false;
+/** Time grouping and pixels from clusters of adjacent strips instead of single strips */
+bool isUseStripClusters = false;
+
+std::atomic<int> stopFlag(0); // Global flag to detect Ctrl+C, read by all workers
+// Signal handler function
+void signalHandler(int signum) {
+  std::cout << "\nInterrupt signal (" << signum << ") received. Stopping loop...\n";
+  stopFlag = 1;  // Set flag to break loop
+}
+
+
+/** Options of the time grouping modules of all workers and stages */
+void configureTimeGrouping(INO::INOTimeGroupingModule& inoTimeGrouping) {
+  INO::TimeGroupingParameters pars = inoTimeGrouping.getParameters();
+  pars.useStripClusters = isUseStripClusters;
+  inoTimeGrouping.setParameters(pars);
+}
+
+
+/** Histograms filled by one worker, merged into the first worker's at the end */
+struct HistogramShard {
+  std::map<std::string, TH1D*> eventMetaHistograms;
+  std::map<INO::StripId, TH1D*> stripTimeDelay;
+  std::map<INO::SideId, TH1D*> positionResidual;
+  std::map<INO::SideId, TH1D*> unbiasedResidual;
+  std::map<INO::SideId, TH1D*> specialHistograms;
+  INO::INOEfficiencyAccumulator efficiency;
+};
+
+/** Add the histograms of from to the ones of into with the same key, from is left empty */
+template<typename Key>
+void mergeHistograms(std::map<Key, TH1D*>& into, std::map<Key, TH1D*>& from) {
+  for (auto& item : from) {
+    auto it = into.find(item.first);
+    if (it == into.end())
+      into[item.first] = item.second;
+    else {
+      it->second->Add(item.second);
+      delete item.second;
+    }
+  }
+  from.clear();
+}
+
+void mergeHistograms(HistogramShard& into, HistogramShard& from) {
+  mergeHistograms(into.eventMetaHistograms, from.eventMetaHistograms);
+  mergeHistograms(into.stripTimeDelay, from.stripTimeDelay);
+  mergeHistograms(into.positionResidual, from.positionResidual);
+  mergeHistograms(into.unbiasedResidual, from.unbiasedResidual);
+  mergeHistograms(into.specialHistograms, from.specialHistograms);
+  into.efficiency.merge(from.efficiency);
+}
+
+
+// the time grouping needs at least 4 strips, events with fewer fill nothing
+bool hasEnoughStrips(const INO::RawEvent& event) {
+  int nStripHits = 0;
+  for(int ij=0;ij<nlayer;ij++)
+    for(int nj=0;nj<nside;nj++)
+      nStripHits += __builtin_popcountll(event.xydata[nj][ij]);
+  return nStripHits >= 4;
+}
+
+
+/** Result of the track stage of one event, the input of the histogram filling */
+struct EventTrack {
+  double firstGroupMean;               /**< mean time of group 0, NaN if no strip is only in it */
+  double secondGroupMean;              /**< mean time of group 1, NaN if no strip is only in it */
+  bool isFitted;                       /**< a track is found and fitted */
+  std::vector<INO::StripCluster> clusters; /**< clusters of adjacent strips, with --strip-clusters */
+  std::vector<INO::PixelId> allPixels; /**< pixels of the group 0 hits */
+  std::vector<INO::PixelId> trackPixels; /**< pixels of the found track, one per layer */
+  std::vector<TVector3> ext;           /**< fitted positions, one per pixel of the fit */
+  INO::LineFitBuffer fitPoints;        /**< pixel positions of the fit, kept for their capacity */
+  std::vector<INO::EfficiencyProbe> probes; /**< tests of the layers of efficiencyParameters */
+};
+
+/** Group means, pixels and straight line fit of one event after its time grouping */
+void reconstructTrack(const INO::INOEvent& inoEvent,
+                      const INO::INOPixelGeometry& pixelGeometry,
+                      EventTrack& track) {
+  INO_SCOPED_TIMER("track");
+
+  // compute event time
+  track.firstGroupMean = std::numeric_limits<double>::quiet_NaN();
+  track.secondGroupMean = std::numeric_limits<double>::quiet_NaN();
+  track.isFitted = false;
+  track.allPixels.clear();
+  track.trackPixels.clear();
+  track.ext.clear();
+  track.probes.clear();
+  for (const auto& hit : inoEvent.getHitRange()) {
+    INO::StripId stripId = hit.stripId;
+    const auto& groupIds = inoEvent.getTimeGroupId(stripId);
+    if (int(groupIds.size()) == 1) {
+      if (groupIds[0] == 0)
+        track.firstGroupMean = std::get<1>(inoEvent.getTimeGroupInfo(stripId)[0]);
+      if (groupIds[0] == 1)
+        track.secondGroupMean = std::get<1>(inoEvent.getTimeGroupInfo(stripId)[0]);
+    }
+  }
+
+  std::vector<INO::PixelId>& allPixels = track.allPixels;
+  if (isUseStripClusters) {
+    INO::findClusters(inoEvent, track.clusters);
+    if (!INO::formClusterPixels(inoEvent, track.clusters, allPixels)) return;
+  } else if (!INO::formPixels(inoEvent, allPixels)) return;
+
+  // each layer under test with the track of the others
+  INO::probeLayers(inoEvent, pixelGeometry, {0, 0, 0, 0}, efficiencyParameters, track.probes);
+  // std::cout << " total pixels " << allPixels.size() << endl;
+
+  // one pixel per layer, unless all of them are fitted
+  if (!isFitAllPixels &&
+      !INO::findTrack(allPixels, pixelGeometry, trackFindingParameters, track.trackPixels)) return;
+  const std::vector<INO::PixelId>& fitPixels = isFitAllPixels ? allPixels : track.trackPixels;
+
+  INO::LineFitBuffer& fitPoints = track.fitPoints;
+  std::vector<TVector3>& ext = track.ext;
+  fitPoints.clear();
+  for (auto pixel : fitPixels)
+    fitPoints.add(pixelGeometry.getPosition(pixel), 0.008, 0.008);
+  INO::LineFitResult fit;
+  {
+    INO_SCOPED_TIMER("track/fit");
+    INO::fitLine(0, fitPoints.getPoints(), fit);
+  }
+  ext.clear();
+  for (double z : fitPoints.z)
+    ext.emplace_back(fit.getValue(0, z), fit.getValue(1, z), z);
+  track.isFitted = true;
+
+#ifdef isDebug
+  for (int ij=0;ij<int(ext.size());ij++)
+    std::cout << " X " << fitPoints.value[0][ij] / stripwidth
+              << " Y " << fitPoints.value[1][ij] / stripwidth
+              << " extX " << ext[ij].X() / stripwidth
+              << " extY " << ext[ij].Y() / stripwidth
+              << " layer " << ext[ij].Z()
+              << " layerI " << getILayer(ext[ij].Z())
+              << std::endl;
+#endif
+
+
+  // time fit
+  std::vector<TVector3>  time_pos;
+  std::vector<TVector2>  time_poserr;
+  std::vector<bool>      time_occulay;
+  TVector2         time_slope;
+  TVector2         time_inter;
+  TVector2         time_chi2;
+  std::vector<TVector3> time_ext;
+  std::vector<TVector3> time_exterr;
+  time_pos.clear(); time_poserr.clear(); time_occulay.clear();
+}
+
+
+/** Fill the histograms of one event from its reconstructed track */
+void fillEventHistograms(const INO::INOEvent& inoEvent,
+                         const EventTrack& track,
+                         const INO::INOPixelGeometry& pixelGeometry,
+                         HistogramShard& histograms) {
+  INO_SCOPED_TIMER("fill");
+
+  auto firstGroupMeanHist = histograms.eventMetaHistograms.find("firstGroupMean");
+  if (firstGroupMeanHist == histograms.eventMetaHistograms.end()) {
+    histograms.eventMetaHistograms["firstGroupMean"]
+      = new TH1D("firstGroupMean",
+                 "firstGroupMean",
+                 200, -25, 25);
+    histograms.eventMetaHistograms["firstGroupMean"]->SetDirectory(0);
+    histograms.eventMetaHistograms["secondGroupMean"]
+      = new TH1D("secondGroupMean",
+                 "secondGroupMean",
+                 2300, -1000, 22000);
+    histograms.eventMetaHistograms["secondGroupMean"]->SetDirectory(0);
+  }
+  if (!std::isnan(track.firstGroupMean))
+    histograms.eventMetaHistograms["firstGroupMean"]->Fill(track.firstGroupMean);
+  if (!std::isnan(track.secondGroupMean))
+    histograms.eventMetaHistograms["secondGroupMean"]->Fill(track.secondGroupMean);
+
+  for (const auto& probe : track.probes) {
+    histograms.efficiency.add(probe);
+    // residual to the track of the other layers
+    for (int nj : {0, 1}) {
+      if (std::isnan(probe.residual[nj])) continue;
+      INO::SideId sideId = {probe.cell.module, probe.cell.row, probe.cell.column, probe.cell.layer, nj};
+      auto it = histograms.unbiasedResidual.find(sideId);
+      if (it == histograms.unbiasedResidual.end()) {
+        std::string histName = "unbiased_" + INO::getSideName(sideId);
+        it = histograms.unbiasedResidual.emplace(sideId, new TH1D(histName.c_str(), histName.c_str(),
+                                                                  500, -0.25, 0.25)).first;
+        it->second->SetDirectory(0);
+      }
+      it->second->Fill(probe.residual[nj]);
+    }
+  }
+
+  if (!track.isFitted) return;
+
+  std::map<INO::SideId, double> layerTimes;
+  for (auto extHit : track.ext) {
+    int layer = getILayer(extHit.Z());
+    for (auto pixel : isFitAllPixels ? track.allPixels : track.trackPixels) {
+      if (layer != pixel.layer) continue;
+      TVector3 rawPos = pixelGeometry.getPosition(pixel);
+      for (int nj : {0, 1}) {
+        // position
+        INO::SideId sideId = {pixel.module, pixel.row, pixel.column,
+                              layer, nj};
+        auto it = histograms.positionResidual.find(sideId);
+        if (it == histograms.positionResidual.end()) {
+          std::string sideName = INO::getSideName(sideId);
+          histograms.positionResidual[sideId] = new TH1D(sideName.c_str(),
+                                                         sideName.c_str(),
+                                                         500, -0.25, 0.25);
+          histograms.positionResidual[sideId]->SetDirectory(0);
+        }
+        histograms.positionResidual[sideId]->Fill(extHit[nj] - rawPos[nj]);
+        // time
+        INO::StripId stripId = {pixel.module, pixel.row, pixel.column,
+                                layer, nj, pixel.strip[nj]};
+        auto itt = histograms.stripTimeDelay.find(stripId);
+        if (itt == histograms.stripTimeDelay.end()) {
+          std::string stripName = INO::getStripName(stripId);
+          histograms.stripTimeDelay[stripId] = new TH1D(stripName.c_str(),
+                                                        stripName.c_str(),
+                                                        200, -312.5, -212.5);
+          histograms.stripTimeDelay[stripId]->SetDirectory(0);
+        }
+        if(int(inoEvent.getRawLeadingTimes(stripId).size())) {
+          double time = inoEvent.getRawLeadingTimes(stripId)[0];
+          time -= extHit[!nj] / spdl_mpns;
+          histograms.stripTimeDelay[stripId]->Fill(time);
+        }
+        if(int(inoEvent.getCalibratedLeadingTimes(stripId).size())) {
+          double time = inoEvent.getCalibratedLeadingTimes(stripId)[0];
+          time -= extHit[!nj] / spdl_mpns;
+          // earliest time in layer
+          auto layerTime = layerTimes.find(sideId);
+          if (layerTime != layerTimes.end()) {
+            double previousTime = layerTime->second;
+            if (previousTime > time) layerTimes[sideId] = time;
+          } else
+            layerTimes[sideId] = time;
+        }
+      }
+    }
+  }
+
+  for (auto item : layerTimes) {
+    auto sideId = item.first;
+    int time = item.second;
+    INO::SideId checkSide = {sideId.module, sideId.row, sideId.column,
+                             sideId.layer + 1, sideId.side};
+    auto layerTime = layerTimes.find(checkSide);
+    if (layerTime != layerTimes.end()) {
+      auto itt = histograms.specialHistograms.find(sideId);
+      if (itt == histograms.specialHistograms.end()) {
+        std::string sideName = "layerTimeDifference_" + INO::getSideName(sideId);
+        histograms.specialHistograms[sideId] = new TH1D(sideName.c_str(),
+                                                        sideName.c_str(),
+                                                        100, -25, 25);
+        histograms.specialHistograms[sideId]->SetDirectory(0);
       }
-      intersect[nj] = sxy[nj]/sn[nj] - tmpslp[nj]*sz[nj]/sn[nj];
+      histograms.specialHistograms[sideId]->Fill(time - layerTime->second);
+    }
+  }
+}
+
+
+/** Input files and how they are read, shared by all workers */
+struct InputSettings {
+  std::vector<std::string> files;
+  int prefetchDepth;
+  int treeCacheMB;
+};
+
+/**
+ * Everything one worker thread owns: its input, its event and grouping
+ * module and its histograms. Nothing here is shared between workers.
+ */
+struct Worker {
+  int fileIndex = -1;    /**< file of eventSource, -1 if none is open */
+  std::unique_ptr<INO::INOEventSource> eventSource;
+  INO::INOPrefetchingEventSource* prefetcher = nullptr;
+  double inputStallSeconds = 0;  /**< of the closed sources */
+  double outputStallSeconds = 0; /**< of the closed sources */
+
+  std::shared_ptr<INO::INOEvent> inoEvent;
+  std::shared_ptr<INO::INOTimeGroupingModule> inoTimeGrouping;
+  EventTrack track;
+  HistogramShard histograms;
+
+  Long64_t nEntries = 0; /**< entries processed by this worker */
+  // state of the progress printout
+  std::chrono::steady_clock::time_point start_s = std::chrono::steady_clock::now();
+  uint64_t allocations_s = 0;  /**< of the thread of the worker */
+  Long64_t entries_s = 0;
+};
+
+/** Entries processed by all workers, for the progress printout */
+std::atomic<Long64_t> nProcessedEntries(0);
+
+/** Close the source of worker, keeping its stall times */
+void closeSource(Worker& worker) {
+  if (worker.prefetcher) {
+    worker.inputStallSeconds += worker.prefetcher->getInputStallSeconds();
+    worker.outputStallSeconds += worker.prefetcher->getOutputStallSeconds();
+  }
+  worker.eventSource.reset();
+  worker.prefetcher = nullptr;
+  worker.fileIndex = -1;
+}
+
+/** Prepare the source of worker for the entries of chunk, opening its file if needed */
+bool prepareSource(Worker& worker, const InputSettings& input, const INO::WorkChunk& chunk) {
+  if (worker.fileIndex != chunk.fileIndex) {
+    closeSource(worker);
+    // SNM ROOT file or compact hit file
+    worker.eventSource = INO::openEventSource(input.files[chunk.fileIndex]);
+    if (!worker.eventSource) return false;
+    worker.fileIndex = chunk.fileIndex;
+    // only the first nlayer layers are analysed
+    worker.eventSource->setActiveLayers((1u << nlayer) - 1);
+    worker.eventSource->setCacheSize(int64_t(input.treeCacheMB) << 20);
+
+    // read ahead on a background thread
+    if (input.prefetchDepth > 0) {
+      worker.prefetcher = new INO::INOPrefetchingEventSource(std::move(worker.eventSource), input.prefetchDepth);
+      worker.eventSource.reset(worker.prefetcher);
+      worker.prefetcher->setPrefilter(hasEnoughStrips);
+    }
+  }
+  if (worker.prefetcher) worker.prefetcher->start(chunk.first, chunk.last);
+  return true;
+}
+
+/**
+ * Process the entries first..last with the state of worker.
+ * Only the worker with isReporting prints the progress.
+ */
+void processEntries(Worker& worker, Long64_t first, Long64_t last,
+                    const INO::INOPixelGeometry& pixelGeometry, bool isReporting) {
+
+  INO::INOEventSource& eventSource = *worker.eventSource;
+  INO::INOEvent& inoEvent = *worker.inoEvent;
+
+  for(Long64_t iev=first; iev<=last; iev++) {
+      
+    if(isReporting && worker.nEntries%1000==0) {
+      auto stop_s = std::chrono::steady_clock::now();
+      // allocations per entry of this worker, the workers do alike, if they are counted
+      uint64_t allocations = INO::getThreadAllocationCount();
+      Long64_t processed = nProcessedEntries;
+      cout << " file " << worker.fileIndex
+           << " iev " << iev
+           << " time " << std::chrono::duration<double>(stop_s-worker.start_s).count();
+      if (INO::isAllocationCounterEnabled)
+        cout << " allocations/event " << (allocations - worker.allocations_s) / std::max(1., double(worker.nEntries - worker.entries_s));
+      cout << " processed " << processed
+           << " input stall " << worker.inputStallSeconds + (worker.prefetcher ? worker.prefetcher->getInputStallSeconds() : 0.)
+           << endl;
+      worker.allocations_s = allocations;
+      worker.entries_s = worker.nEntries;
+    }
+    worker.nEntries++;
+    nProcessedEntries++;
+    INO_COUNT("events", 1);
+  
+    // strip bits and TDC hit counts first, the TDC times only if needed
+    if (!eventSource.readHeader(iev)) continue;
+    const INO::RawEvent* event = &eventSource.getEvent();
+
+    inoEvent.reset();
 
-      double determ = (sn[nj]*sz2[nj] - sz[nj]*sz[nj]);
-      errcst[nj] = sz2[nj]/determ;
-      errcov[nj] = -sz[nj]/determ;
-      errlin[nj] = sn[nj]/determ;
+    TTimeStamp eventTime = event->evetime[0];
+    inoEvent.setEventTime(eventTime.AsDouble() + (5 * 3600) + (30 * 60));
+
+    if (!hasEnoughStrips(*event)) continue;
+    INO_COUNT("selectedEvents", 1);
+    {
+      INO_SCOPED_TIMER("read/tdc");
+      eventSource.readTDCs();
     }
-  } // for(int nj=0;nj<nside;nj++) {
-  slope.SetX(tmpslp[0]);
-  slope.SetY(tmpslp[1]);
-  inter.SetX(intersect[0]);
-  inter.SetY(intersect[1]);
-
-  // theta = atan(sqrt(pow(tmpslp[0],2.)+pow(tmpslp[1],2.)));
-  // phi = atan2(tmpslp[1],tmpslp[0]);
-
-  double sumx = 0, sumy = 0;
-  ext.clear(); exterr.clear();
-  for(int ij=0;ij<int(pos.size());ij++){
-    TVector3 xxt;
-    TVector3 xxtt;
-    xxt.SetX(tmpslp[0]*pos[ij].Z()+intersect[0]);
-    xxt.SetY(tmpslp[1]*pos[ij].Z()+intersect[1]);
-    xxt.SetZ(pos[ij].Z());
-    ext.push_back(xxt);
-    xxtt.SetX(errcst[0] + 2*errcov[0]*pos[ij].Z()+
-              errlin[0]*pos[ij].Z()*pos[ij].Z());
-    xxtt.SetY(errcst[1] + 2*errcov[1]*pos[ij].Z()+
-              errlin[1]*pos[ij].Z()*pos[ij].Z());
-    exterr.push_back(xxtt);
-    // cout << " " << int(exterr.size())
-    // 	 << " " << 1./exterr.back().X()
-    // 	 << " " << 1./exterr.back().Y() << endl;
-    if(int(occulay.size())==0 || occulay[ij]) {
-      sumx += pow(xxt.X()-pos[ij].X(), 2.)/poserr[ij].X(); 
-      sumy += pow(xxt.Y()-pos[ij].Y(), 2.)/poserr[ij].Y(); 
+
+    // #ifdef isDebug
+    //     cout << " time " << eventTime << endl;
+    // #endif  // #ifdef isDebug
+
+    // setting rawTDCs and strip hits
+    INO::decodeEvent(*event, inoEvent, nlayer, tdc_least);
+
+    worker.inoTimeGrouping->process();
+
+#ifdef isDebug
+    for (const auto& hit : inoEvent.getHitRange()) {
+      INO::StripId stripId = hit.stripId;
+      double calibratedTime = inoEvent.getCalibratedLeadingTimes(stripId)[0];
+      double low = inoEvent.getLowestCalibratedLeadingTime();
+      double high = inoEvent.getHighestCalibratedLeadingTime();
+      std::cout << std::setw(10) << "Module: " << stripId.module
+                << " | Row: " << stripId.row
+                << " | Column: " << stripId.column
+                << " | Layer: " << stripId.layer
+                << " | Side: " << (stripId.side ? "Y" : "X")
+                << " | Strip: " << stripId.strip
+                << " | Groups: " << inoEvent.getTimeGroupId(stripId).size()
+                << " | Calibrated Time: "
+                << std::fixed << std::setprecision(3) << calibratedTime << " ns"
+        // << " | Low Time: " << low << " ns"
+        // << " | High Time: " << high << " ns"
+                << std::endl;
+    }
+#endif
+    reconstructTrack(inoEvent, pixelGeometry, worker.track);
+    fillEventHistograms(inoEvent, worker.track, pixelGeometry, worker.histograms);
+
+    if (stopFlag) {
+      if (isReporting) std::cout << "Exiting loop due to Ctrl+C.\n";
+      break;
     }
-  } // for(int ij=0;ij<int(pos.size());ij++){
-  chi2.SetX(sumx);
-  chi2.SetY(sumy);
+
+  } // for(Long64_t iev=first;iev<=last;iev++) {
+}
+
+/** Process the chunks the scheduler hands to worker workerIndex until all are done */
+void runWorker(Worker& worker, int workerIndex, INO::INOWorkScheduler& scheduler,
+               const InputSettings& input, const INO::INOPixelGeometry& pixelGeometry) {
+  INO::WorkChunk chunk;
+  worker.allocations_s = INO::getThreadAllocationCount();
+  while (!stopFlag && scheduler.next(workerIndex, chunk)) {
+    if (!prepareSource(worker, input, chunk)) continue;
+    processEntries(worker, chunk.first, chunk.last, pixelGeometry, workerIndex == 0);
+  }
+  closeSource(worker);
+}
+
+
+/** One event on its way through the pipeline stages */
+struct PipelineTask {
+  std::unique_ptr<INO::RawEvent> rawEvent;
+  std::shared_ptr<INO::INOEvent> inoEvent;
+  EventTrack track;
 };
 
+/** Throughput of one pipeline stage, summed over its threads */
+struct StageStats {
+  const char* name;
+  int nThreads = 0;
+  std::atomic<Long64_t> nEvents{0};
+  std::atomic<int64_t> busyNanoseconds{0}; /**< time spent on events, without waiting for the queues */
+  std::atomic<int> nFinished{0};           /**< threads that ran out of input */
+};
 
-volatile sig_atomic_t stopFlag = 0; // Global flag to detect Ctrl+C
-// Signal handler function
-void signalHandler(int signum) {
-  std::cout << "\nInterrupt signal (" << signum << ") received. Stopping loop...\n";
-  stopFlag = 1;  // Set flag to break loop
+typedef INO::INOBoundedQueue<PipelineTask*> TaskQueue;
+
+/**
+ * Events flow read -> decode -> group -> track -> fill through bounded
+ * queues, each stage with its own threads. A fixed pool of tasks is
+ * recycled from the fill stage back to the readers, so the pipeline
+ * holds at most depth events.
+ */
+struct Pipeline {
+  explicit Pipeline(int depth) :
+    freeTasks(depth), readQueue(depth), decodeQueue(depth), groupQueue(depth), trackQueue(depth) {}
+
+  std::vector<std::unique_ptr<PipelineTask>> tasks;
+  TaskQueue freeTasks;   /**< input of read */
+  TaskQueue readQueue;   /**< read -> decode */
+  TaskQueue decodeQueue; /**< decode -> group */
+  TaskQueue groupQueue;  /**< group -> track */
+  TaskQueue trackQueue;  /**< track -> fill */
+
+  StageStats read   {"read"};
+  StageStats decode {"decode"};
+  StageStats group  {"group"};
+  StageStats track  {"track"};
+  StageStats fill   {"fill"};
+};
+
+/** Nanoseconds since start */
+inline int64_t getNanosecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Pop tasks from input until it is closed, apply work and push them to
+ * output. The last thread of the stage closes output.
+ */
+template<typename Work>
+void runStage(StageStats& stats, TaskQueue& input, TaskQueue& output, Work work) {
+  PipelineTask* task;
+  int64_t busyNanoseconds = 0;
+  while (input.pop(task)) {
+    auto start = std::chrono::steady_clock::now();
+    work(*task);
+    busyNanoseconds += getNanosecondsSince(start);
+    stats.nEvents++;
+    output.push(task);
+  }
+  stats.busyNanoseconds += busyNanoseconds;
+  if (++stats.nFinished == stats.nThreads) output.close();
+}
+
+/** Read stage: the selected entries of the chunks of reader into free tasks */
+void runReadStage(Worker& reader, int readerIndex, INO::INOWorkScheduler& scheduler,
+                  const InputSettings& input, Pipeline& pipeline) {
+  StageStats& stats = pipeline.read;
+  int64_t busyNanoseconds = 0;
+  INO::WorkChunk chunk;
+  while (!stopFlag && scheduler.next(readerIndex, chunk)) {
+    if (!prepareSource(reader, input, chunk)) continue;
+    INO::INOEventSource& eventSource = *reader.eventSource;
+    for(Long64_t iev=chunk.first; iev<=chunk.last && !stopFlag; iev++) {
+      auto start = std::chrono::steady_clock::now();
+      nProcessedEntries++;
+      INO_COUNT("events", 1);
+      // strip bits and TDC hit counts first, the TDC times only if needed
+      if (!eventSource.readHeader(iev) || !hasEnoughStrips(eventSource.getEvent())) {
+        busyNanoseconds += getNanosecondsSince(start);
+        continue;
+      }
+      INO_COUNT("selectedEvents", 1);
+      eventSource.readTDCs();
+      busyNanoseconds += getNanosecondsSince(start);
+
+      PipelineTask* task;
+      pipeline.freeTasks.pop(task);
+      start = std::chrono::steady_clock::now();
+      INO::copyRawEvent(eventSource.getEvent(), *task->rawEvent);
+      busyNanoseconds += getNanosecondsSince(start);
+      stats.nEvents++;
+      pipeline.readQueue.push(task);
+    }
+  }
+  closeSource(reader);
+  stats.busyNanoseconds += busyNanoseconds;
+  if (++stats.nFinished == stats.nThreads) pipeline.readQueue.close();
+}
+
+/** Decode stage: the hits of the raw event into the INOEvent of the task */
+void decodeTask(PipelineTask& task) {
+  INO::INOEvent& inoEvent = *task.inoEvent;
+  inoEvent.reset();
+  TTimeStamp eventTime = task.rawEvent->evetime[0];
+  inoEvent.setEventTime(eventTime.AsDouble() + (5 * 3600) + (30 * 60));
+  // setting rawTDCs and strip hits
+  INO::decodeEvent(*task.rawEvent, inoEvent, nlayer, tdc_least);
+}
+
+/** Throughput and queue occupancy of every stage */
+void printPipelineStats(const Pipeline& pipeline, double wallSeconds) {
+  const StageStats* stages[] = {&pipeline.read, &pipeline.decode, &pipeline.group, &pipeline.track, &pipeline.fill};
+  const TaskQueue* inputs[] = {&pipeline.freeTasks, &pipeline.readQueue, &pipeline.decodeQueue,
+                               &pipeline.groupQueue, &pipeline.trackQueue};
+  cout << " pipeline wall time " << wallSeconds << " s" << endl;
+  for (int ij=0; ij<5; ij++) {
+    const StageStats& stats = *stages[ij];
+    double busySeconds = stats.busyNanoseconds * 1e-9;
+    cout << std::setw(8) << stats.name
+         << " | threads " << stats.nThreads
+         << " | events " << stats.nEvents
+         << " | events/s per thread " << (busySeconds > 0 ? stats.nEvents / busySeconds : 0.)
+         << " | busy " << 100. * busySeconds / std::max(1e-9, wallSeconds * stats.nThreads) << " %"
+         << " | input queue mean " << inputs[ij]->getMeanOccupancy()
+         << " max " << inputs[ij]->getMaxOccupancy() << "/" << inputs[ij]->getCapacity()
+         << endl;
+  }
 }
 
 int main(int argc, char** argv) {
 
   /* 
      argv[0]  : main
-     argv[1]  : inputfilename
+     argv[1]  : inputfilename (SNM ROOT file or compact hit file), a quoted
+                glob pattern of them or @listfile with one file per line
      argv[2]  : outputfilename
-     argv[3]  : start event
-     argv[4]  : end event
+     argv[3]  : start event, in every input file
+     argv[4]  : end event, in every input file
      argv[5]  : output file number
      argv[6]  : itermodule
      argv[7]  : iterxrow
      argv[8]  : iteryrow
      argv[9]  : iterlayer
      argv[10] : (empty or additional argument)
+
+     options, anywhere on the command line:
+     --prefetch-depth=N : events read ahead on a background thread (default 8, 0: read on the main thread)
+     --tree-cache-mb=N  : TTreeCache size for SNM input (default 64)
+     --threads=N        : workers processing chunks of the entry ranges (default 1), each with its own input
+     --min-chunk=N      : smallest chunk of entries handed to a worker (default 500)
+     --max-chunk=N      : largest chunk of entries handed to a worker (default 20000)
+     --pipeline         : run the stages read, decode, group, track and fill on their own
+                          threads, connected by bounded queues, instead of the workers
+     --pipeline-depth=N : events in the pipeline at once (default 64)
+     --read-threads=N, --decode-threads=N, --group-threads=N, --track-threads=N, --fill-threads=N
+                        : threads of each stage (default 1, 1, 2, 2, 1)
+     --strip-clusters          : group the times and form the pixels of clusters of adjacent strips
+     --all-pixels              : fit all pixels of the group 0 hits instead of the ones of the found track
+     --track-road=M            : largest distance of a track pixel from the track [m] (default 0.06)
+     --track-min-layers=N      : least number of layers of a found track, at least 2 (default 5)
+     --efficiency-layers=L,..  : layers whose efficiency and residual to the track of the other layers
+                                 are measured (default the trigger layers 0,1,2,3)
+     --efficiency-road=M       : largest distance of a matching hit from the track [m] (default 0.06)
+     --efficiency-min-layers=N : least number of other layers in the track fit (default 5)
+     --instrumentation-out=F : summary of the timers, JSON or CSV (".csv"), only if built
+                          with INO_INSTRUMENTATION (default <outputfilename>_instrumentation.json)
   */
   
   // #ifdef isIter
@@ -211,12 +728,53 @@ int main(int argc, char** argv) {
   //   int iterlayer = stoi(argv[8]);
   // #endif	// #ifdef isIter
 
+  std::map<std::string, std::string> options = INO::takeOptions(argc, argv, {
+      "prefetch-depth", "tree-cache-mb", "threads", "min-chunk", "max-chunk",
+      "pipeline", "pipeline-depth", "read-threads", "decode-threads", "group-threads", "track-threads", "fill-threads",
+      "strip-clusters", "all-pixels", "track-road", "track-min-layers",
+      "efficiency-layers", "efficiency-road", "efficiency-min-layers", "instrumentation-out"});
+  int prefetchDepth = INO::getIntOption(options, "prefetch-depth", 8);
+  int treeCacheMB = INO::getIntOption(options, "tree-cache-mb", 64);
+  int nThreads = std::max(1, INO::getIntOption(options, "threads", 1));
+  int minChunk = INO::getIntOption(options, "min-chunk", 500);
+  int maxChunk = INO::getIntOption(options, "max-chunk", 20000);
+  bool isPipeline = options.count("pipeline");
+  int pipelineDepth = std::max(1, INO::getIntOption(options, "pipeline-depth", 64));
+  int nReadThreads = std::max(1, INO::getIntOption(options, "read-threads", 1));
+  int nDecodeThreads = std::max(1, INO::getIntOption(options, "decode-threads", 1));
+  int nGroupThreads = std::max(1, INO::getIntOption(options, "group-threads", 2));
+  int nTrackThreads = std::max(1, INO::getIntOption(options, "track-threads", 2));
+  int nFillThreads = std::max(1, INO::getIntOption(options, "fill-threads", 1));
+  // the shards of the fill threads are merged like the ones of the workers
+  if (isPipeline) nThreads = nFillThreads;
+  efficiencyParameters.testLayerMask = 0;
+  for (int layer : INO::getIntListOption(options, "efficiency-layers",
+                                         std::vector<int>(trigLayers, trigLayers + ntrigLayers)))
+    if (layer >= 0 && layer < nlayer) efficiencyParameters.testLayerMask |= 1u << layer;
+  isFitAllPixels = options.count("all-pixels");
+  isUseStripClusters = options.count("strip-clusters");
+  trackFindingParameters.road = INO::getDoubleOption(options, "track-road", trackFindingParameters.road);
+  // a line needs two layers
+  trackFindingParameters.minLayers = std::max(2, INO::getIntOption(options, "track-min-layers",
+                                                                    trackFindingParameters.minLayers));
+  efficiencyParameters.road = INO::getDoubleOption(options, "efficiency-road", efficiencyParameters.road);
+  efficiencyParameters.minFitLayers = INO::getIntOption(options, "efficiency-min-layers", efficiencyParameters.minFitLayers);
+
   // Register signal handler for Ctrl+C
   signal(SIGINT, signalHandler);
 
+  if (nThreads > 1 || isPipeline) {
+    // files are read and histograms are filled on several threads
+    ROOT::EnableThreadSafety();
+    // TMinuit keeps its state in the global gMinuit, Minuit2 fits can run in parallel
+    ROOT::Math::MinimizerOptions::SetDefaultMinimizer("Minuit2");
+  }
+  // histograms of the workers stay out of the (thread-local) current directory
+  TH1::AddDirectory(kFALSE);
+
   const char *sideMark[nside] = {"x","y"};
 
-  Double_t evetimeFill, evesepFill, recotimeFill, recosepFill;
+  Double_t recotimeFill, recosepFill;
   
   unsigned int triggerinfo_ref = 0;
   for(int ij=0;ij<ntrigLayers;ij++) {
@@ -243,13 +801,12 @@ int main(int argc, char** argv) {
     O : [the letter o, not a zero] a boolean (Bool_t)
   */
 
-  INO::INOCalibrationManager& inoCalibrationManager = INO::INOCalibrationManager::getInstance();
+  // the pixel geometry loads the calibration here, the workers only read it
+  INO::INOPixelGeometry pixelGeometry(stripwidth, airGap + ironThickness, rpcZShift);
 
   // INO::INOStorageManager& inoStorageManager = INO::INOStorageManager::getInstance();
 
 
-  char datafile[1000] = {};
-  strncpy(datafile,argv[1],1000);
   char outfile[1000] = {};
   strncpy(outfile,argv[2],1000);
   Long64_t nentrymn = stoi(argv[3]);
@@ -261,298 +818,129 @@ int main(int argc, char** argv) {
   // auto fileOut = inoStorageManager.getRootFile(std::string(outfile) + ".root", "recreate");
   // if(!fileOut) return 0;
 
-  std::map<std::string, TH1D*> eventMetaHistograms;
-  std::map<INO::StripId, TH1D*> stripTimeDelay;
-  std::map<INO::SideId, TH1D*> positionResidual;
-  std::map<INO::SideId, TH2D*> layerEfficiency;
-  std::map<INO::SideId, TH1D*> specialHistograms;
-
-  TFile* fileIn = new TFile(datafile, "read");
-
-  if(fileIn->IsZombie()) return 0;
-
-  TTree *event_tree = (TTree*)fileIn->Get("SNM");
-  SNM *event = new SNM(event_tree);
-  event->Loop();
-  
-  Long64_t start_s = clock();
-
-  Long64_t nentry = event_tree->GetEntries();
-  for(Long64_t iev=nentrymn; iev<=TMath::Min(nentry - 1, nentrymx); iev++) {
-      
-    if(iev%1000==0) {
-      Long64_t stop_s = clock();
-      cout << " iev " << iev
-           << " time " << (stop_s-start_s)/Double_t(CLOCKS_PER_SEC)
-           << endl;
+  // the entries nentrymn..nentrymx of every readable input file
+  InputSettings input = {{}, prefetchDepth, treeCacheMB};
+  std::vector<INO::WorkChunk> ranges;
+  for (const std::string& datafile : INO::expandFileList(argv[1])) {
+    std::unique_ptr<INO::INOEventSource> eventSource = INO::openEventSource(datafile);
+    if(!eventSource) continue;
+    Long64_t nentry = eventSource->getEntries();
+    input.files.push_back(datafile);
+    ranges.push_back({int(input.files.size()) - 1, nentrymn, TMath::Min(nentry - 1, nentrymx)});
+  }
+  if(ranges.empty()) return 0;
+
+  // chunks of the ranges are handed to the workers (or readers) with work
+  // stealing, each has its own sources
+  INO::INOWorkScheduler scheduler(ranges, isPipeline ? nReadThreads : nThreads, minChunk, maxChunk);
+  std::vector<Worker> workers(nThreads);
+  auto start_s = std::chrono::steady_clock::now();
+
+  if (!isPipeline) {
+    for (auto& worker : workers) {
+      // one event and one grouping module are reused for all entries of the worker
+      worker.inoEvent = std::make_shared<INO::INOEvent>();
+      worker.inoTimeGrouping = std::make_shared<INO::INOTimeGroupingModule>(worker.inoEvent);
+      configureTimeGrouping(*worker.inoTimeGrouping);
     }
-  
-    fileIn->cd();
-    event_tree->GetEntry(iev);
-
-    std::shared_ptr<INO::INOEvent> inoEvent = std::make_shared<INO::INOEvent>();
-
-    TTimeStamp eventTime = event->evetime[0];
-    inoEvent->setEventTime(eventTime.AsDouble() + (5 * 3600) + (30 * 60));
-    evesepFill = inoEvent->getEventTime() - evetimeFill;
-    evetimeFill = inoEvent->getEventTime();
-
-    // #ifdef isDebug
-    //     cout << " time " << eventTime << endl;
-    // #endif  // #ifdef isDebug
-
-    // setting rawTDCs
-    for(int ij=0;ij<nlayer;ij++)
-      for(int nj=0;nj<nside;nj++)
-        for (int ntdc = 0; ntdc < 8; ntdc++) {
-          int nTDCHits = event->xythit[nj][ij][ntdc];
-          for (int tc = 0; tc < nTDCHits; tc++) {
-            int rawTDCl = event->xytime[nj][ij][ntdc][tc] * tdc_least;
-            int rawTDCt = rawTDCl + event->plWidth[nj][ij][ntdc][tc] * tdc_least;
-            inoEvent->addTDC(INO::TDCId{0,0,0,ij,nj,ntdc}, rawTDCl, 0);
-            inoEvent->addTDC(INO::TDCId{0,0,0,ij,nj,ntdc}, rawTDCt, 1);
-          }
-        }
-    // setting strip hits
-    for(int ij=0;ij<nlayer;ij++)
-      for(int nj=0;nj<nside;nj++)
-        for(int kl=nstrip-1; kl>=0; kl--)
-          if((event->xydata[nj][ij]>>kl)&0x01)
-            inoEvent->addHit(INO::StripId{0,0,0,ij,nj,kl});
 
-    std::shared_ptr<INO::INOTimeGroupingModule> inoTimeGrouping = std::make_shared<INO::INOTimeGroupingModule>(inoEvent);
-    inoTimeGrouping->process();
-
-#ifdef isDebug
-    for (const auto* hit : inoEvent->getHits()) {
-      INO::StripId stripId = hit->stripId;
-      double calibratedTime = inoEvent->getCalibratedLeadingTimes(stripId)[0];
-      double low = inoEvent->getLowestCalibratedLeadingTime();
-      double high = inoEvent->getHighestCalibratedLeadingTime();
-      std::cout << std::setw(10) << "Module: " << stripId.module
-                << " | Row: " << stripId.row
-                << " | Column: " << stripId.column
-                << " | Layer: " << stripId.layer
-                << " | Side: " << (stripId.side ? "Y" : "X")
-                << " | Strip: " << stripId.strip
-                << " | Groups: " << inoEvent->getTimeGroupId(stripId).size()
-                << " | Calibrated Time: "
-                << std::fixed << std::setprecision(3) << calibratedTime << " ns"
-        // << " | Low Time: " << low << " ns"
-        // << " | High Time: " << high << " ns"
-                << std::endl;
-    }
-#endif
-
-    // compute event time
-    double firstGroupMean = std::numeric_limits<double>::quiet_NaN();
-    double secondGroupMean = std::numeric_limits<double>::quiet_NaN();
-    for (const auto* hit : inoEvent->getHits()) {
-      INO::StripId stripId = hit->stripId;
-      auto groupIds = inoEvent->getTimeGroupId(stripId);
-      if (int(groupIds.size()) == 1) {
-        if (groupIds[0] == 0)
-          firstGroupMean = std::get<1>(inoEvent->getTimeGroupInfo(stripId)[0]);
-        if (groupIds[0] == 1)
-          secondGroupMean = std::get<1>(inoEvent->getTimeGroupInfo(stripId)[0]);
-      }
-    }
-    auto firstGroupMeanHist = eventMetaHistograms.find("firstGroupMean");
-    if (firstGroupMeanHist == eventMetaHistograms.end()) {
-      eventMetaHistograms["firstGroupMean"] = new TH1D("firstGroupMean",
-                                                       "firstGroupMean",
-                                                       200, -25, 25);
-      eventMetaHistograms["firstGroupMean"]->SetDirectory(0);
-      eventMetaHistograms["secondGroupMean"]
-        = new TH1D("secondGroupMean",
-                   "secondGroupMean",
-                   2300, -1000, 22000);
-      eventMetaHistograms["secondGroupMean"]->SetDirectory(0);
-    }
-    if (!std::isnan(firstGroupMean))
-      eventMetaHistograms["firstGroupMean"]->Fill(firstGroupMean);
-    if (!std::isnan(secondGroupMean))
-      eventMetaHistograms["secondGroupMean"]->Fill(secondGroupMean);
-
-    std::map<INO::SideId, std::vector<INO::StripId>> stripHits;
-    for (const auto* hit : inoEvent->getHits()) {
-      INO::StripId stripId = hit->stripId;
-      if(!int(inoEvent->getCalibratedLeadingTimes(stripId).size())) continue;
-      auto groupIds = inoEvent->getTimeGroupId(stripId);
-      if (std::find(groupIds.begin(), groupIds.end(), 0) == groupIds.end()) continue; // only group 0
-      stripHits[{hit->stripId.module,
-            hit->stripId.row,
-            hit->stripId.column,
-            hit->stripId.layer,
-            hit->stripId.side}].push_back(hit->stripId);
-    }
-    if (int(stripHits.size()) < 10) continue;
-    std::vector<INO::PixelId> allPixels;
-    for (auto stripHit : stripHits) {
-      if (int(stripHit.second.size()) > 5) continue;
-      auto sideId = stripHit.first;
-      auto it = stripHits.find({sideId.module,
-                                sideId.row,
-                                sideId.column,
-                                sideId.layer,
-                                !sideId.side});
-      if (it != stripHits.end())
-        for (auto strip1 : stripHit.second)
-          for (auto strip2 : it->second)
-            allPixels.push_back({sideId.module,
-                                 sideId.row,
-                                 sideId.column,
-                                 sideId.layer,
-                                 {sideId.side ? strip2.strip : strip1.strip,
-                                  sideId.side ? strip1.strip : strip2.strip} });
-    }
-    // std::cout << " total pixels " << allPixels.size() << endl;
-
-    std::vector<TVector3>  pos;
-    std::vector<TVector2>  poserr;
-    std::vector<bool>      occulay;
-    TVector2         slope;
-    TVector2         inter;
-    TVector2         chi2;
-    std::vector<TVector3> ext;
-    std::vector<TVector3> exterr;
-    pos.clear(); poserr.clear(); occulay.clear();
-    for (auto pixel : allPixels) {
-      TVector3 rawPos = {(pixel.strip[0] + 0.5) * stripwidth,
-                         (pixel.strip[1] + 0.5) * stripwidth,
-                         getLayerZ(pixel.layer)};
-      TVector3 rpcPosition, rpcOrientation;
-      inoCalibrationManager
-        .getLayerPosition({pixel.module, pixel.row, pixel.column,
-                           pixel.layer},
-          pixel.strip[0] < 32 ? 0 : 1,
-          pixel.strip[1] < 32 ? 0 : 1,
-          rpcPosition, rpcOrientation);
-      rpcPosition.SetZ(0);
-      rawPos += rpcPosition;
-      rawPos.RotateX(rpcOrientation.X() * TMath::DegToRad());
-      rawPos.RotateY(rpcOrientation.Y() * TMath::DegToRad());
-      rawPos.RotateZ(rpcOrientation.Z() * TMath::DegToRad());
-      pos.push_back(rawPos);
-      poserr.push_back({0.008, 0.008});
-    }
-    LinearVectorFit(0, pos, poserr, occulay, slope, inter, chi2, ext, exterr);
-
-#ifdef isDebug
-    for (int ij=0;ij<int(pos.size());ij++)
-      std::cout << " X " << pos[ij].X() / stripwidth
-                << " Y " << pos[ij].Y() / stripwidth
-                << " extX " << ext[ij].X() / stripwidth
-                << " extY " << ext[ij].Y() / stripwidth
-                << " layer " << ext[ij].Z()
-                << " layerI " << getILayer(ext[ij].Z())
-                << std::endl;
-#endif
-
-
-    std::map<INO::SideId, double> layerTimes;
-    for (auto extHit : ext) {
-      int layer = getILayer(extHit.Z());
-      for (auto pixel : allPixels) {
-        if (layer != pixel.layer) continue;
-        TVector3 rawPos = {(pixel.strip[0] + 0.5) * stripwidth,
-                           (pixel.strip[1] + 0.5) * stripwidth,
-                           getLayerZ(pixel.layer)};
-        TVector3 rpcPosition, rpcOrientation;
-        inoCalibrationManager
-          .getLayerPosition({pixel.module, pixel.row, pixel.column,
-                             pixel.layer},
-            pixel.strip[0] < 32 ? 0 : 1,
-            pixel.strip[1] < 32 ? 0 : 1,
-            rpcPosition, rpcOrientation);
-        rpcPosition.SetZ(0);
-        rawPos += rpcPosition;
-        rawPos.RotateX(rpcOrientation.X() * TMath::DegToRad());
-        rawPos.RotateY(rpcOrientation.Y() * TMath::DegToRad());
-        rawPos.RotateZ(rpcOrientation.Z() * TMath::DegToRad());
-        for (int nj : {0, 1}) {
-          // position
-          INO::SideId sideId = {pixel.module, pixel.row, pixel.column,
-                                layer, nj};
-          auto it = positionResidual.find(sideId);
-          if (it == positionResidual.end()) {
-            std::string sideName = INO::getSideName(sideId);
-            positionResidual[sideId] = new TH1D(sideName.c_str(),
-                                                sideName.c_str(),
-                                                500, -0.25, 0.25);
-            positionResidual[sideId]->SetDirectory(0);
-          }
-          positionResidual[sideId]->Fill(extHit[nj] - rawPos[nj]);
-          // time
-          INO::StripId stripId = {pixel.module, pixel.row, pixel.column,
-                                  layer, nj, pixel.strip[nj]};
-          auto itt = stripTimeDelay.find(stripId);
-          if (itt == stripTimeDelay.end()) {
-            std::string stripName = INO::getStripName(stripId);
-            stripTimeDelay[stripId] = new TH1D(stripName.c_str(),
-                                               stripName.c_str(),
-                                               200, -312.5, -212.5);
-            stripTimeDelay[stripId]->SetDirectory(0);
-          }
-          if(int(inoEvent->getRawLeadingTimes(stripId).size())) {
-            double time = inoEvent->getRawLeadingTimes(stripId)[0];
-            time -= extHit[!nj] / spdl_mpns;
-            stripTimeDelay[stripId]->Fill(time);
-          }
-          if(int(inoEvent->getCalibratedLeadingTimes(stripId).size())) {
-            double time = inoEvent->getCalibratedLeadingTimes(stripId)[0];
-            time -= extHit[!nj] / spdl_mpns;
-            // earliest time in layer
-            auto layerTime = layerTimes.find(sideId);
-            if (layerTime != layerTimes.end()) {
-              double previousTime = layerTime->second;
-              if (previousTime > time) layerTimes[sideId] = time;
-            } else
-              layerTimes[sideId] = time;
-          }
-        }
-      }
+    std::vector<std::thread> threads;
+    for (int ij=1; ij<nThreads; ij++)
+      threads.emplace_back(runWorker, std::ref(workers[ij]), ij, std::ref(scheduler),
+                           std::cref(input), std::cref(pixelGeometry));
+    // the first worker runs on the main thread
+    runWorker(workers[0], 0, scheduler, input, pixelGeometry);
+    for (auto& thread : threads) thread.join();
+
+    double inputStall = 0, outputStall = 0;
+    for (auto& worker : workers) {
+      inputStall += worker.inputStallSeconds;
+      outputStall += worker.outputStallSeconds;
     }
-
-    for (auto item : layerTimes) {
-      auto sideId = item.first;
-      int time = item.second;
-      INO::SideId checkSide = {sideId.module, sideId.row, sideId.column,
-                               sideId.layer + 1, sideId.side};
-      auto layerTime = layerTimes.find(checkSide);
-      if (layerTime != layerTimes.end()) {
-        auto itt = specialHistograms.find(sideId);
-        if (itt == specialHistograms.end()) {
-          std::string sideName = "layerTimeDifference_" + INO::getSideName(sideId);
-          specialHistograms[sideId] = new TH1D(sideName.c_str(),
-                                               sideName.c_str(),
-                                               100, -25, 25);
-          specialHistograms[sideId]->SetDirectory(0);
-        }
-        specialHistograms[sideId]->Fill(time - layerTime->second);
-      }
+    if (prefetchDepth > 0)
+      cout << " input stall " << inputStall << " s"
+           << " | read-ahead idle " << outputStall << " s" << endl;
+  } else {
+    Pipeline pipeline(pipelineDepth);
+    for (int ij=0; ij<pipelineDepth; ij++) {
+      pipeline.tasks.emplace_back(new PipelineTask);
+      pipeline.tasks.back()->rawEvent.reset(new INO::RawEvent);
+      pipeline.tasks.back()->inoEvent = std::make_shared<INO::INOEvent>();
+      pipeline.freeTasks.push(pipeline.tasks.back().get());
     }
-
-
-    // time fit
-    std::vector<TVector3>  time_pos;
-    std::vector<TVector2>  time_poserr;
-    std::vector<bool>      time_occulay;
-    TVector2         time_slope;
-    TVector2         time_inter;
-    TVector2         time_chi2;
-    std::vector<TVector3> time_ext;
-    std::vector<TVector3> time_exterr;
-    time_pos.clear(); time_poserr.clear(); time_occulay.clear();
-
-
-    if (stopFlag) {
-      std::cout << "Exiting loop due to Ctrl+C.\n";
-      break;
+    pipeline.read.nThreads = nReadThreads;
+    pipeline.decode.nThreads = nDecodeThreads;
+    pipeline.group.nThreads = nGroupThreads;
+    pipeline.track.nThreads = nTrackThreads;
+    pipeline.fill.nThreads = nFillThreads;
+
+    std::vector<Worker> readers(nReadThreads);
+    std::vector<std::thread> threads;
+    for (int ij=0; ij<nReadThreads; ij++)
+      threads.emplace_back(runReadStage, std::ref(readers[ij]), ij, std::ref(scheduler),
+                           std::cref(input), std::ref(pipeline));
+    for (int ij=0; ij<nDecodeThreads; ij++)
+      threads.emplace_back([&] {
+          runStage(pipeline.decode, pipeline.readQueue, pipeline.decodeQueue, decodeTask);
+        });
+    for (int ij=0; ij<nGroupThreads; ij++)
+      threads.emplace_back([&] {
+          // one grouping module per thread, pointed at the event of each task
+          INO::INOTimeGroupingModule inoTimeGrouping(std::make_shared<INO::INOEvent>());
+          configureTimeGrouping(inoTimeGrouping);
+          runStage(pipeline.group, pipeline.decodeQueue, pipeline.groupQueue, [&](PipelineTask& task) {
+              inoTimeGrouping.setEvent(task.inoEvent);
+              inoTimeGrouping.process();
+            });
+        });
+    for (int ij=0; ij<nTrackThreads; ij++)
+      threads.emplace_back([&] {
+          runStage(pipeline.track, pipeline.groupQueue, pipeline.trackQueue, [&](PipelineTask& task) {
+              reconstructTrack(*task.inoEvent, pixelGeometry, task.track);
+            });
+        });
+    // each fill thread fills the shard of one worker
+    for (int ij=0; ij<nFillThreads; ij++)
+      threads.emplace_back([&, ij] {
+          HistogramShard& histograms = workers[ij].histograms;
+          runStage(pipeline.fill, pipeline.trackQueue, pipeline.freeTasks, [&](PipelineTask& task) {
+              fillEventHistograms(*task.inoEvent, task.track, pixelGeometry, histograms);
+            });
+        });
+
+    // progress of the stages every 10 s until the fill threads are done
+    for (int nTicks = 1; pipeline.fill.nFinished < nFillThreads; nTicks++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      if (nTicks % 100) continue;
+      cout << " entries " << nProcessedEntries
+           << " | queued read " << pipeline.readQueue.getSize()
+           << " decode " << pipeline.decodeQueue.getSize()
+           << " group " << pipeline.groupQueue.getSize()
+           << " track " << pipeline.trackQueue.getSize()
+           << " | fill events " << pipeline.fill.nEvents << endl;
     }
-
-  } // for(Long64_t iev=nentrymn;iev<nentry;iev++) {
-  fileIn->Close();
+    for (auto& thread : threads) thread.join();
+
+    double inputStall = 0;
+    for (auto& reader : readers) inputStall += reader.inputStallSeconds;
+    if (prefetchDepth > 0)
+      cout << " input stall " << inputStall << " s" << endl;
+    printPipelineStats(pipeline, std::chrono::duration<double>(std::chrono::steady_clock::now() - start_s).count());
+  }
+  cout << " files " << input.files.size() << " | entries " << nProcessedEntries
+       << " | steals " << scheduler.getNSteals() << endl;
+
+  // merge the shards of all workers into the first one, in worker order;
+  // the histograms hold counts, so the sums do not depend on which worker
+  // processed which chunk
+  HistogramShard& histograms = workers[0].histograms;
+  for (int ij=1; ij<nThreads; ij++)
+    mergeHistograms(histograms, workers[ij].histograms);
+  std::map<std::string, TH1D*>& eventMetaHistograms = histograms.eventMetaHistograms;
+  std::map<INO::StripId, TH1D*>& stripTimeDelay = histograms.stripTimeDelay;
+  std::map<INO::SideId, TH1D*>& positionResidual = histograms.positionResidual;
+  std::map<INO::SideId, TH1D*>& unbiasedResidual = histograms.unbiasedResidual;
+  std::map<INO::SideId, TH1D*>& specialHistograms = histograms.specialHistograms;
 
   TDirectory* dir = fileOut->mkdir("EventMeta");
   dir->cd();
@@ -564,6 +952,11 @@ int main(int argc, char** argv) {
   for (auto& item : positionResidual)
     if(item.second)
       item.second->Write();
+  dir = fileOut->mkdir("UnbiasedResidual");
+  dir->cd();
+  for (auto& item : unbiasedResidual)
+    if(item.second)
+      item.second->Write();
   dir = fileOut->mkdir("StripTimeDelay");
   dir->cd();
   for (auto& item : stripTimeDelay)
@@ -574,14 +967,31 @@ int main(int argc, char** argv) {
   for (auto& item : specialHistograms)
     if(item.second)
       item.second->Write();
+  // counts only, merge-efficiency adds them over jobs and computes the intervals
+  histograms.efficiency.write(fileOut->mkdir("Efficiency"));
+  for (int layer = 0; layer < nlayer; layer++) {
+    if (!((efficiencyParameters.testLayerMask >> layer) & 1)) continue;
+    const INO::EfficiencyCounts& counts = histograms.efficiency.getLayerCounts({0, 0, 0, layer});
+    double low, high;
+    counts.getInterval(0.682689, low, high);
+    cout << " efficiency layer " << layer << " " << counts.getEfficiency()
+         << " [" << low << ", " << high << "] " << counts.passed << "/" << counts.total << endl;
+  }
   fileOut->Close();
 
+  // timers and counters, only with -DINO_INSTRUMENTATION=ON
+  INO_WRITE_INSTRUMENTATION(options.count("instrumentation-out") ? options["instrumentation-out"]
+                            : std::string(outfile) + "_instrumentation.json");
+
   for (auto& item : stripTimeDelay)
     if(item.second)
       delete item.second;
   for (auto& item : positionResidual)
     if(item.second)
       delete item.second;
+  for (auto& item : unbiasedResidual)
+    if(item.second)
+      delete item.second;
   for (auto& item : eventMetaHistograms)
     if(item.second)
       delete item.second;
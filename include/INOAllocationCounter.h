@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+namespace INO {
+
+#ifdef INO_ALLOCATION_COUNTER
+
+  /** Whether the global operator new of this program counts allocations */
+  const bool isAllocationCounterEnabled = true;
+
+  /** Number of calls to the global operator new by the calling thread.
+   *
+   * The counter is meant for differences, e.g. allocations per event =
+   * (count after - count before) / events on the thread processing them.
+   * Allocations of other threads, like a read-ahead thread, are not in it.
+   *
+   * The operator is only replaced in programs built with
+   * INO_ALLOCATION_COUNTER, which are bench and the ones built with
+   * INO_INSTRUMENTATION; elsewhere the count is always 0.
+   */
+  uint64_t getThreadAllocationCount();
+
+#else
+
+  const bool isAllocationCounterEnabled = false;
+
+  inline uint64_t getThreadAllocationCount() { return 0; }
+
+#endif
+
+} // namespace INO
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+namespace INO {
+
+  /**
+   * Bounded lock-free queue for several producer and consumer threads.
+   *
+   * Dmitry Vyukov's array queue: every cell carries a sequence number
+   * that tells whether it is free for the producer of a position or
+   * filled for its consumer, so pushes and pops only contend on their own
+   * position counter. The capacity is rounded up to a power of two.
+   *
+   * push() and pop() wait while the queue is full or empty. After close()
+   * pop() returns false once the queue is empty; close() must only be
+   * called when all pushes are done.
+   */
+  template<typename T>
+  class INOBoundedQueue {
+  public:
+    explicit INOBoundedQueue(size_t capacity) :
+      m_enqueuePos(0), m_dequeuePos(0), m_isClosed(false),
+      m_nPops(0), m_occupancySum(0), m_maxOccupancy(0) {
+      size_t size = 2;
+      while (size < capacity) size <<= 1;
+      m_mask = size - 1;
+      m_cells.reset(new Cell[size]);
+      for (size_t ij = 0; ij < size; ij++) m_cells[ij].sequence.store(ij, std::memory_order_relaxed);
+    }
+
+    INOBoundedQueue(const INOBoundedQueue&) = delete;
+    INOBoundedQueue& operator=(const INOBoundedQueue&) = delete;
+
+    /** Add value, false if the queue is full */
+    bool tryPush(const T& value) {
+      size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+      while (true) {
+        Cell& cell = m_cells[pos & m_mask];
+        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        intptr_t diff = intptr_t(sequence) - intptr_t(pos);
+        if (diff == 0) {
+          if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+            cell.data = value;
+            cell.sequence.store(pos + 1, std::memory_order_release);
+            return true;
+          }
+        } else if (diff < 0) {
+          return false; // the consumer of the previous round has not taken the cell
+        } else {
+          pos = m_enqueuePos.load(std::memory_order_relaxed);
+        }
+      }
+    }
+
+    /** Take the oldest value, false if the queue is empty */
+    bool tryPop(T& value) {
+      size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+      while (true) {
+        Cell& cell = m_cells[pos & m_mask];
+        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        intptr_t diff = intptr_t(sequence) - intptr_t(pos + 1);
+        if (diff == 0) {
+          if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+            value = cell.data;
+            cell.sequence.store(pos + m_mask + 1, std::memory_order_release);
+            recordOccupancy(pos);
+            return true;
+          }
+        } else if (diff < 0) {
+          return false; // the producer has not filled the cell yet
+        } else {
+          pos = m_dequeuePos.load(std::memory_order_relaxed);
+        }
+      }
+    }
+
+    /** Add value, waiting while the queue is full */
+    void push(const T& value) {
+      for (int nTries = 0; !tryPush(value); nTries++) wait(nTries);
+    }
+
+    /** Take the oldest value, waiting while the queue is empty; false when it is closed and empty */
+    bool pop(T& value) {
+      for (int nTries = 0; ; nTries++) {
+        if (tryPop(value)) return true;
+        // the pushes before close() are visible once the flag is seen
+        if (m_isClosed.load(std::memory_order_acquire)) return tryPop(value);
+        wait(nTries);
+      }
+    }
+
+    /** No more values will be pushed */
+    void close() { m_isClosed.store(true, std::memory_order_release); }
+
+    size_t getCapacity() const { return m_mask + 1; }
+
+    /** Number of values in the queue, approximate while other threads use it */
+    size_t getSize() const {
+      size_t enqueuePos = m_enqueuePos.load(std::memory_order_relaxed);
+      size_t dequeuePos = m_dequeuePos.load(std::memory_order_relaxed);
+      return enqueuePos > dequeuePos ? enqueuePos - dequeuePos : 0;
+    }
+
+    /** Mean number of values in the queue seen by the pops */
+    double getMeanOccupancy() const {
+      uint64_t nPops = m_nPops.load(std::memory_order_relaxed);
+      return nPops ? double(m_occupancySum.load(std::memory_order_relaxed)) / nPops : 0.;
+    }
+    /** Largest number of values in the queue seen by the pops */
+    size_t getMaxOccupancy() const { return m_maxOccupancy.load(std::memory_order_relaxed); }
+
+  private:
+    struct Cell {
+      std::atomic<size_t> sequence;
+      T data;
+    };
+
+    /** Spin first, then give the core away, then sleep */
+    static void wait(int nTries) {
+      if (nTries < 64) return;
+      if (nTries < 256) std::this_thread::yield();
+      else std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+
+    /** Queue length at the pop of position pos */
+    void recordOccupancy(size_t pos) {
+      size_t size = m_enqueuePos.load(std::memory_order_relaxed) - pos;
+      m_nPops.fetch_add(1, std::memory_order_relaxed);
+      m_occupancySum.fetch_add(size, std::memory_order_relaxed);
+      size_t maxOccupancy = m_maxOccupancy.load(std::memory_order_relaxed);
+      while (size > maxOccupancy &&
+             !m_maxOccupancy.compare_exchange_weak(maxOccupancy, size, std::memory_order_relaxed)) {}
+    }
+
+    std::unique_ptr<Cell[]> m_cells;
+    size_t m_mask;
+    // producers and consumers work on different cache lines
+    alignas(64) std::atomic<size_t> m_enqueuePos;
+    alignas(64) std::atomic<size_t> m_dequeuePos;
+    alignas(64) std::atomic<bool> m_isClosed;
+    std::atomic<uint64_t> m_nPops;
+    std::atomic<uint64_t> m_occupancySum;
+    std::atomic<size_t> m_maxOccupancy;
+  };
+
+} // namespace INO
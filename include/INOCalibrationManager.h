@@ -2,7 +2,10 @@
 
 #include <sqlite3.h>
 #include <string>
+#include <vector>
 #include <iostream>
+#include <mutex>
+#include <atomic>
 
 #include "TVector3.h"
 
@@ -10,20 +13,39 @@
 
 namespace INO {
 
+  /**
+   * Calibration constants of calibration.db.
+   *
+   * The getters can be called from several threads at once. The setters,
+   * reloadStripTimeDelays and invalidateStripTimeDelays must not run while
+   * other threads read.
+   */
   class INOCalibrationManager {
   public:
     static INOCalibrationManager& getInstance();
 
     void setStripTimeDelay(const StripId& stripId, double time);
     double getStripTimeDelay(const StripId& stripId) const;
+    // Re-read the StripTimeDelay table into the in-memory cache
+    void reloadStripTimeDelays();
+    // Mark the cache stale, it is re-read on the next lookup
+    void invalidateStripTimeDelays();
     void getLayerPosition(const LayerId& layerId, const int& x, const int& y, TVector3& position, TVector3& orientation) const;
 
   private:
     INOCalibrationManager();
     ~INOCalibrationManager();
     void initializeDatabase();
+    void loadStripTimeDelays() const;
+    double queryStripTimeDelay(const StripId& stripId) const;
 
     sqlite3* db;
+    /* serializes the use of db */
+    mutable std::mutex dbMutex;
+
+    /* StripTimeDelay table indexed by getStripIndex */
+    mutable std::vector<double> stripTimeDelays;
+    mutable std::atomic<bool> isStripTimeDelayCacheValid;
   };
 
 } // namespace INO
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "INOStructs.h"
+#include "INOEvent.h"
+
+namespace INO {
+
+  /** Call f(first, size) for every run of adjacent set bits of bits, lowest run first. */
+  template <class F>
+  inline void forEachBitRun(uint64_t bits, F&& f)
+  {
+    while (bits) {
+      int first = __builtin_ctzll(bits);
+      uint64_t rest = ~(bits >> first);
+      int size = rest ? __builtin_ctzll(rest) : 64 - first;
+      f(first, size);
+      bits &= size + first < 64 ? ~uint64_t(0) << (first + size) : 0;
+    }
+  }
+
+  /** Adjacent fired strips of one layer side */
+  struct StripCluster {
+    SideId sideId;
+    int firstStrip;
+    int size;      /**< number of strips */
+    double time;   /**< earliest calibrated leading time of the strips [ns], NaN without times */
+
+    /** Centre of the strips, in strips */
+    double getCentroid() const { return firstStrip + 0.5 * (size - 1); }
+    /** Strip at the centre, the lower one of the two central strips of an even size */
+    int getCentralStrip() const { return firstStrip + (size - 1) / 2; }
+  };
+
+  /**
+   * Clusters of every layer side of inoEvent, the runs of set bits of its
+   * strip masks, in strip order. clusters is cleared first and keeps its
+   * capacity.
+   */
+  void findClusters(const INOEvent& inoEvent, std::vector<StripCluster>& clusters);
+
+  /**
+   * Calibrated leading times of the strips of cluster, sorted and each
+   * time once. The strips of a TDC share its times, so a cluster has the
+   * times of its neighbours too and the earliest one is not always its own.
+   */
+  void collectClusterTimes(const INOEvent& inoEvent, const StripCluster& cluster, std::vector<double>& times);
+
+  /**
+   * Pixels of the clusters with a strip in time group 0, as formPixels
+   * does with the strips: every x cluster with every y cluster of the same
+   * layer, layers with more than 5 such clusters on both sides are skipped.
+   * Unlike formPixels, each pixel is listed once, at the central strips of
+   * its clusters.
+   * @return false if fewer than 10 sides have group 0 clusters
+   */
+  bool formClusterPixels(const INOEvent& inoEvent, const std::vector<StripCluster>& clusters,
+                         std::vector<PixelId>& pixels);
+
+} // namespace INO
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cstdlib>
+#include <glob.h>
+
+namespace INO {
+
+  /**
+   * Take the options "--name=value" and "--name" out of argv.
+   *
+   * The remaining arguments are moved to the front of argv and argc is
+   * updated, so the positional arguments keep their numbers. An option
+   * that is not in names is reported, with the accepted ones, and ends
+   * the program.
+   * @return option values by name, "1" for options without a value
+   */
+  inline std::map<std::string, std::string> takeOptions(int& argc, char** argv,
+                                                        const std::vector<std::string>& names)
+  {
+    std::map<std::string, std::string> options;
+    int nKept = 1;
+    for (int ij = 1; ij < argc; ij++) {
+      if (std::strncmp(argv[ij], "--", 2) != 0) {
+        argv[nKept++] = argv[ij];
+        continue;
+      }
+      std::string option = argv[ij] + 2;
+      size_t equal = option.find('=');
+      std::string name = option.substr(0, equal);
+      if (std::find(names.begin(), names.end(), name) == names.end()) {
+        std::cerr << "Error: unknown option --" << name << "\n"
+                  << "usage: " << argv[0] << " accepts the options";
+        for (const auto& known : names) std::cerr << " --" << known;
+        std::cerr << std::endl;
+        std::exit(1);
+      }
+      options[name] = equal == std::string::npos ? "1" : option.substr(equal + 1);
+    }
+    argc = nKept;
+    argv[argc] = nullptr;
+    return options;
+  }
+
+  /** Report a value of option name that is not a number and end the program */
+  [[noreturn]] inline void failOptionValue(const std::string& name, const std::string& value)
+  {
+    std::cerr << "Error: --" << name << "=" << value << " is not a valid value" << std::endl;
+    std::exit(1);
+  }
+
+  /** Text value of option name as an int, ending the program if it is not one */
+  inline int parseIntOption(const std::string& name, const std::string& value)
+  {
+    size_t end = 0;
+    int result = 0;
+    try {
+      result = std::stoi(value, &end);
+    } catch (const std::exception&) {
+      failOptionValue(name, value);
+    }
+    if (end != value.size()) failOptionValue(name, value);
+    return result;
+  }
+
+  /** Text value of option name as a double, ending the program if it is not one */
+  inline double parseDoubleOption(const std::string& name, const std::string& value)
+  {
+    size_t end = 0;
+    double result = 0;
+    try {
+      result = std::stod(value, &end);
+    } catch (const std::exception&) {
+      failOptionValue(name, value);
+    }
+    if (end != value.size()) failOptionValue(name, value);
+    return result;
+  }
+
+  /** Value of option name as an int, defaultValue if it is not given */
+  inline int getIntOption(const std::map<std::string, std::string>& options,
+                          const std::string& name, int defaultValue)
+  {
+    auto it = options.find(name);
+    return it == options.end() ? defaultValue : parseIntOption(name, it->second);
+  }
+
+  /** Value of option name as a double, defaultValue if it is not given */
+  inline double getDoubleOption(const std::map<std::string, std::string>& options,
+                                const std::string& name, double defaultValue)
+  {
+    auto it = options.find(name);
+    return it == options.end() ? defaultValue : parseDoubleOption(name, it->second);
+  }
+
+  /** Comma separated values of option name, converted by parse, defaultValue if it is not given */
+  template <class T, class Parse>
+  inline std::vector<T> getListOption(const std::map<std::string, std::string>& options,
+                                      const std::string& name, const std::vector<T>& defaultValue, Parse parse)
+  {
+    auto it = options.find(name);
+    if (it == options.end()) return defaultValue;
+    std::vector<T> values;
+    size_t start = 0;
+    while (start <= it->second.size()) {
+      size_t comma = it->second.find(',', start);
+      if (comma == std::string::npos) comma = it->second.size();
+      if (comma > start) values.push_back(parse(name, it->second.substr(start, comma - start)));
+      start = comma + 1;
+    }
+    return values;
+  }
+
+  /** Comma separated ints of option name, defaultValue if it is not given */
+  inline std::vector<int> getIntListOption(const std::map<std::string, std::string>& options,
+                                           const std::string& name, const std::vector<int>& defaultValue)
+  {
+    return getListOption(options, name, defaultValue, parseIntOption);
+  }
+
+  /** Comma separated doubles of option name, defaultValue if it is not given */
+  inline std::vector<double> getDoubleListOption(const std::map<std::string, std::string>& options,
+                                                 const std::string& name, const std::vector<double>& defaultValue)
+  {
+    return getListOption(options, name, defaultValue, parseDoubleOption);
+  }
+
+  /**
+   * Input files of an argument: the lines of the file after '@' for
+   * "@list", otherwise the files matching the glob pattern, in sorted
+   * order. A pattern without matches is returned as it is.
+   */
+  inline std::vector<std::string> expandFileList(const std::string& argument)
+  {
+    std::vector<std::string> files;
+    if (!argument.empty() && argument[0] == '@') {
+      std::ifstream list(argument.substr(1));
+      std::string line;
+      while (std::getline(list, line))
+        if (!line.empty() && line[0] != '#') files.push_back(line);
+      return files;
+    }
+    glob_t matches;
+    if (glob(argument.c_str(), 0, nullptr, &matches) == 0)
+      for (size_t ij = 0; ij < matches.gl_pathc; ij++) files.push_back(matches.gl_pathv[ij]);
+    globfree(&matches);
+    if (files.empty()) files.push_back(argument);
+    return files;
+  }
+
+} // namespace INO
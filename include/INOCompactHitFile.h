@@ -0,0 +1,119 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "INOEventSource.h"
+
+namespace INO {
+
+  /*
+   * Compact hit file
+   *
+   * A zero-suppressed, columnar copy of the SNM tree. After the header
+   * follow the columns, each one contiguous and in this order:
+   *
+   *   uint64_t nevt[nEvents]
+   *   double   evetime[nEvents]          evetime[0] of the SNM event
+   *   uint64_t maskBegin[nEvents + 1]    first strip mask of each event
+   *   uint64_t tdcBegin[nEvents + 1]     first TDC hit of each event
+   *   uint64_t mask[nMasks]              non-zero xydata words
+   *   int32_t  leading[nTDCHits]         xytime
+   *   uint16_t width[nTDCHits]           plWidth
+   *   uint16_t channel[nTDCHits]         (side * nRawLayers + layer) * nRawTDCs + tdc
+   *   uint8_t  maskSide[nMasks]          side * nRawLayers + layer
+   *
+   * The TDC hits of an event are ordered by channel, the hits of one channel
+   * keep their SNM order. Numbers are stored in the byte order of the host.
+   */
+
+  /** First bytes of a compact hit file */
+  const char compactHitFileMagic[8] = {'I', 'N', 'O', 'H', 'I', 'T', 'S', '1'};
+
+  /** Header of a compact hit file, 64 bytes */
+  struct CompactHitFileHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t nEvents;
+    uint64_t nMasks;
+    uint64_t nTDCHits;
+    uint64_t unused[3];
+  };
+
+  /**
+   * Writes RawEvents to a compact hit file.
+   *
+   * The columns are kept in memory and written by close().
+   */
+  class INOCompactHitWriter {
+  public:
+    explicit INOCompactHitWriter(const std::string& fileName);
+    ~INOCompactHitWriter();
+
+    /** Append an event, all 12 layers are stored */
+    void addEvent(const RawEvent& event);
+
+    /** Write the file, false if writing failed */
+    bool close();
+
+  private:
+    std::string m_fileName;
+    bool m_isClosed;
+    std::vector<uint64_t> m_nevt;
+    std::vector<double>   m_evetime;
+    std::vector<uint64_t> m_maskBegin;
+    std::vector<uint64_t> m_tdcBegin;
+    std::vector<uint64_t> m_mask;
+    std::vector<int32_t>  m_leading;
+    std::vector<uint16_t> m_width;
+    std::vector<uint16_t> m_channel;
+    std::vector<uint8_t>  m_maskSide;
+  };
+
+  /**
+   * Events of a compact hit file, read through a memory map.
+   *
+   * readHeader() sets nevt, evetime[0], xydata and xythit, the other
+   * evetime entries are zero.
+   */
+  class INOCompactEventSource : public INOEventSource {
+  public:
+    /** Map fileName, check isOpen() afterwards */
+    explicit INOCompactEventSource(const std::string& fileName);
+    ~INOCompactEventSource();
+
+    bool isOpen() const { return m_data != nullptr; }
+
+    int64_t getEntries() const override { return m_header ? m_header->nEvents : 0; }
+    void setActiveLayers(unsigned layerMask) override { m_activeLayers = layerMask; }
+    bool readHeader(int64_t entry) override;
+    void readTDCs() override;
+
+  private:
+    /**
+     * Whether the columns fit the RawEvent: the begins increase and end at
+     * the numbers of masks and TDC hits, the sides and channels are in
+     * range and each channel of an event has its hits in a row, at most 255.
+     */
+    bool hasValidColumns() const;
+
+    const char* m_data;  /**< mapped file */
+    size_t      m_size;
+    unsigned    m_activeLayers;
+    int64_t     m_entry; /**< entry of the last readHeader */
+
+    const CompactHitFileHeader* m_header;
+    const uint64_t* m_nevt;
+    const double*   m_evetime;
+    const uint64_t* m_maskBegin;
+    const uint64_t* m_tdcBegin;
+    const uint64_t* m_mask;
+    const int32_t*  m_leading;
+    const uint16_t* m_width;
+    const uint16_t* m_channel;
+    const uint8_t*  m_maskSide;
+  };
+
+} // namespace INO
@@ -0,0 +1,18 @@
+#pragma once
+
+namespace INO {
+
+  /*
+   * Geometry and readout of the stack, shared by the analysis programs,
+   * the event generator and bench, so that generated events are
+   * reconstructed with the geometry they were made with.
+   */
+
+  constexpr double stripWidth       = 0.03;   /**< [m] */
+  constexpr double ironThickness    = 0.056;  /**< [m] */
+  constexpr double airGap           = 0.045;  /**< [m] */
+  constexpr double layerPitch       = airGap + ironThickness; /**< distance between consecutive layers [m] */
+  constexpr double stripSignalSpeed = 0.2;    /**< signal speed along a strip [m/ns] */
+  constexpr double tdcLeast         = 0.1;    /**< TDC count [ns] */
+
+} // namespace INO
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "INOStructs.h"
+
+class TDirectory;
+
+namespace INO {
+
+  /** A track through a layer under test and the sides with a hit on it */
+  struct EfficiencyProbe {
+    PixelId cell;            /**< layer and strips crossed by the track */
+    bool passed[nSides];     /**< a hit of the side is within the road */
+    double residual[nSides]; /**< hit of the side nearest to the track minus the track [m], NaN without hits */
+  };
+
+  /** Passed and total counts of one efficiency */
+  struct EfficiencyCounts {
+    uint64_t passed = 0;
+    uint64_t total = 0;
+
+    void add(bool isPassed) { total++; passed += isPassed; }
+    void add(const EfficiencyCounts& other) { passed += other.passed; total += other.total; }
+    double getEfficiency() const { return total ? double(passed) / total : 0.; }
+    /** Clopper-Pearson interval with the confidence level, [0, 1] without counts */
+    void getInterval(double level, double& low, double& high) const;
+  };
+
+  /**
+   * Streaming efficiency counts per layer, per layer side and per cell
+   * (x strip, y strip) of a layer.
+   *
+   * A side passes if it has a hit within the road, a layer or a cell if
+   * both of its sides do. Only counts are kept, so accumulators of several
+   * threads are added with merge() and the ones of several jobs through
+   * the histograms of write() and read(), or with hadd.
+   */
+  class INOEfficiencyAccumulator {
+  public:
+    INOEfficiencyAccumulator();
+
+    void add(const EfficiencyProbe& probe);
+
+    /** Add the counts of other */
+    void merge(const INOEfficiencyAccumulator& other);
+
+    /** Counts of layer, empty outside the detector */
+    const EfficiencyCounts& getLayerCounts(const LayerId& layerId) const;
+    const EfficiencyCounts& getSideCounts(const SideId& sideId) const;
+    const EfficiencyCounts& getCellCounts(const PixelId& pixelId) const;
+
+    /** Number of probes added */
+    uint64_t getNProbes() const;
+
+    /**
+     * Write the counts as histograms into directory: "layerPassed" and
+     * "layerTotal" by layer index, "sidePassed" and "sideTotal" by side
+     * index, "cellPassed_<layer index>" and "cellTotal_<layer index>" by
+     * x and y strip.
+     */
+    void write(TDirectory* directory) const;
+
+    /** Add the counts of the histograms written by write(), false if some are missing */
+    bool read(TDirectory* directory);
+
+  private:
+    std::vector<EfficiencyCounts> m_layers; /**< indexed by getLayerIndex */
+    std::vector<EfficiencyCounts> m_sides;  /**< indexed by getSideIndex */
+    std::vector<EfficiencyCounts> m_cells;  /**< indexed by getPixelIndex */
+  };
+
+} // namespace INO
@@ -1,8 +1,10 @@
 #pragma once
 
 #include <vector>
+#include <array>
 #include <map>
 #include <tuple>
+#include <cstdint>
 #include <limits>
 #include <optional>
 #include <iostream>
@@ -12,21 +14,81 @@
 
 namespace INO {
 
+  /** Read-only view over the hits of an event, iterated in strip order.
+   *
+   * The view does not copy, it is valid until the next addHit.
+   */
+  class HitRange {
+  public:
+    class iterator {
+    public:
+      iterator(const HitRange* range, int sideIndex) : m_range(range), m_sideIndex(sideIndex), m_mask(0) {
+        if (m_sideIndex < nSideIndices) m_mask = m_range->m_hitMask[m_sideIndex];
+        advance();
+      }
+      const Hit& operator*() const {
+        return m_range->m_hits[m_range->m_hitSlots[m_sideIndex * nStrips + __builtin_ctzll(m_mask)]];
+      }
+      const Hit* operator->() const { return &**this; }
+      iterator& operator++() {
+        m_mask &= m_mask - 1;
+        advance();
+        return *this;
+      }
+      bool operator==(const iterator& other) const { return m_sideIndex == other.m_sideIndex && m_mask == other.m_mask; }
+      bool operator!=(const iterator& other) const { return !(*this == other); }
+    private:
+      // move to the next layer side with a fired strip
+      void advance() {
+        while (!m_mask && m_sideIndex < nSideIndices) {
+          m_sideIndex++;
+          if (m_sideIndex < nSideIndices) m_mask = m_range->m_hitMask[m_sideIndex];
+        }
+      }
+      const HitRange* m_range;
+      int m_sideIndex;
+      uint64_t m_mask;
+    };
+
+    HitRange(const Hit* hits, const int* hitSlots, const uint64_t* hitMask)
+      : m_hits(hits), m_hitSlots(hitSlots), m_hitMask(hitMask) {}
+    iterator begin() const { return iterator(this, 0); }
+    iterator end() const { return iterator(this, nSideIndices); }
+
+  private:
+    const Hit* m_hits;
+    const int* m_hitSlots;
+    const uint64_t* m_hitMask;
+  };
+
   class INOEvent {
   public:
     INOEvent();
 
+    /** Clear the event for reuse.
+     *
+     * Hit objects, their time vectors and the TDC vectors keep their
+     * capacity, so refilling an event of similar size does not allocate.
+     */
+    void reset();
+
     void addHit(const StripId& stripId);
     bool hasHit(const StripId& stripId) const;
+    /** Bit per strip of the layer side with a hit, 0 outside the detector */
+    uint64_t getStripMask(const SideId& sideId) const;
     void removeHit(const StripId& stripId);
 
-    // Method to get all hits
+    // Method to get all hits, ordered by strip.
+    // The pointers are valid until the next addHit.
     std::vector<const Hit*> getHits() const;
+    // Method to iterate over all hits without copying, ordered by strip
+    HitRange getHitRange() const;
     // Method to get raw leading time of a hit
     double getRawLeadingTime(const StripId& stripId) const;
-    std::vector<double> getRawLeadingTimes(const StripId& stripId) const;
-    // Method to get all leading TDC values
-    std::vector<double> getCalibratedLeadingTimes(const StripId& stripId) const;
+    // Method to get all raw leading times of a hit, empty if there is no hit
+    const std::vector<double>& getRawLeadingTimes(const StripId& stripId) const;
+    // Method to get all calibrated leading times of a hit, empty if there is no hit
+    const std::vector<double>& getCalibratedLeadingTimes(const StripId& stripId) const;
 
     // Method to get tracked leading time of a hit
     double getTrackedLeadingTime(const StripId& stripId) const;
@@ -52,11 +114,11 @@ namespace INO {
     /** Get ID of the time-group.
      * @return time-group ID
      */
-    std::vector<int> getTimeGroupId(const StripId& stripId) const;
+    const std::vector<int>& getTimeGroupId(const StripId& stripId) const;
     /** Get time-group parameters.
      * @return time-group parameters (integral, center, sigma)
      */
-    std::vector<std::tuple<float, float, float>> getTimeGroupInfo(const StripId& stripId) const;
+    const std::vector<std::tuple<float, float, float>>& getTimeGroupInfo(const StripId& stripId) const;
     /** Set ID of the time-group.
      * @return reference to time-group ID
      */
@@ -65,12 +127,24 @@ namespace INO {
      * @return reference to the time-group parameters (integral, center, sigma)
      */
     std::vector<std::tuple<float, float, float>>& setTimeGroupInfo(const StripId& stripId);
+    /** Remove time-group IDs and parameters from all hits. */
+    void clearTimeGroups();
 
     int getEntries() const;
 
   private:
-    std::map<StripId, Hit> rawHits;
-    std::map<TDCId, std::vector<double>> rawTDCs[2]; /* leading and trailing */
+    static_assert(nStrips == 64, "hitMask keeps one 64 bit word per layer side");
+
+    const Hit* findHit(const StripId& stripId) const;
+    Hit* findHit(const StripId& stripId);
+    Hit& findOrCreateHit(const StripId& stripId);
+
+    std::vector<Hit> rawHits;                    /* contiguous hit storage, addressed via hitSlots */
+    int nUsedHitSlots;                           /* rawHits beyond this are kept for reuse */
+    std::array<int, nStripIndices> hitSlots;     /* position in rawHits per strip index, -1 if empty */
+    std::array<uint64_t, nSideIndices> hitMask;  /* occupancy bitmap, one word per layer side */
+    int nHits;
+    std::array<std::vector<double>, nTDCIndices> rawTDCs[2]; /* leading and trailing, per TDC index */
     double eventTime;
     double lowestCalibratedLeadingTime;
     double highestCalibratedLeadingTime;
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "TRandom3.h"
+
+#include "INOStructs.h"
+#include "INOEventSource.h"
+#include "INODetectorConstants.h"
+
+namespace INO {
+
+  /**
+   * Synthetic cosmic-muon events with the layout of the SNM tree.
+   *
+   * Every event has one straight muon track, entering layer 0 (the top
+   * layer) uniformly over the strip area with a cos^3 zenith distribution,
+   * i.e. a cos^2 flux through a flat detector. Positions are local to the
+   * layers, in m from the edge of strip 0; the x strips measure x, the y
+   * strips y.
+   *
+   * A layer crossed by the track fires the strip under the track on both
+   * sides, unless the layer is inefficient for the event, and each
+   * neighbour with clusterProbability, growing the cluster outwards. The
+   * leading time of a strip is the time of the track at the layer, plus
+   * the propagation along the strip to its readout (the coordinate of the
+   * other side over propagationSpeed), plus the delay of the strip from
+   * INOCalibrationManager, plus a Gaussian resolution. The calibrated
+   * times of the analysis thus peak at the track time.
+   *
+   * Noise strips are added with Poisson statistics to every layer side,
+   * with times uniform in noiseTime. Each fired strip adds a hit to the
+   * TDC strip % nTDCs of its layer side.
+   */
+  class INOEventGenerator {
+  public:
+    struct Parameters {
+      double stripWidth           = INO::stripWidth;       /**< [m] */
+      double layerPitch           = INO::layerPitch;       /**< distance between consecutive layers [m] */
+      double propagationSpeed     = INO::stripSignalSpeed; /**< signal speed along a strip [m/ns] */
+      double maxZenith            = 1.0;     /**< largest zenith angle of the tracks [rad] */
+      double trackTime            = 0.;      /**< time of the track at layer 0 [ns] */
+      double timeResolution       = 1.;      /**< sigma of the leading times [ns] */
+      double clusterProbability   = 0.2;     /**< probability to fire each next neighbour strip */
+      double noiseStrips          = 0.5;     /**< mean number of noise strips per layer side */
+      double noiseTime[2]         = {-1000., 1000.}; /**< range of the noise times [ns] */
+      double pulseWidth[2]        = {20., 5.};       /**< mean and sigma of the pulse width [ns] */
+      double tdcLeast             = INO::tdcLeast;         /**< TDC count [ns] */
+      double eventRate            = 100.;    /**< mean trigger rate [Hz] */
+      double startTime            = 1.5e9;   /**< evetime of the first event [s] */
+      std::vector<double> layerEfficiency = std::vector<double>(INO::nLayers, 0.95); /**< per layer */
+      unsigned seed               = 4357;
+    };
+
+    /** True muon of an event */
+    struct Truth {
+      uint64_t nevt;
+      double   x0;                   /**< position at layer 0 [m] */
+      double   y0;
+      double   slopeX;               /**< dx/dz */
+      double   slopeY;               /**< dy/dz */
+      double   time;                 /**< time at layer 0 [ns] */
+      uint32_t efficientLayers;      /**< bit per layer, set if the layer could detect the muon */
+      uint32_t crossedLayers;        /**< bit per layer, set if the track is inside the strip area */
+      int32_t  strip[nSides][nLayers]; /**< strip under the track, -1 if not crossed or inefficient */
+      int32_t  nNoiseStrips;
+    };
+
+    explicit INOEventGenerator(const Parameters& pars);
+
+    /** Fill event with the next event and truth with its muon */
+    void generate(RawEvent& event, Truth& truth);
+
+    const Parameters& getParameters() const { return m_pars; }
+
+  private:
+    /** Add a hit of strip with the calibrated leading time, false if the strip is outside */
+    bool fireStrip(RawEvent& event, int layer, int side, int strip, double time);
+
+    Parameters m_pars;
+    TRandom3 m_random;
+    uint64_t m_nevt;
+    double m_eventTime;
+    /** delays of the strips, indexed by getStripIndex */
+    std::vector<double> m_stripTimeDelays;
+  };
+
+} // namespace INO
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <cstdint>
+
+class TFile;
+class TTree;
+class SNM;
+
+namespace INO {
+
+  /** Dimensions of the SNM arrays */
+  const int nRawSides = 2;
+  const int nRawLayers = 12;
+  const int nRawTDCs = 8;
+  const int nRawTDCHits = 256;
+
+  /**
+   * One event with the array layout of the SNM tree.
+   *
+   * xytime and plWidth are only valid for the first xythit entries of a
+   * channel, the rest keeps values of earlier events.
+   */
+  struct RawEvent {
+    uint64_t nevt;
+    double   evetime[nRawLayers];
+    uint64_t xydata[nRawSides][nRawLayers];
+    uint8_t  xythit[nRawSides][nRawLayers][nRawTDCs];
+    int32_t  xytime[nRawSides][nRawLayers][nRawTDCs][nRawTDCHits];
+    uint16_t plWidth[nRawSides][nRawLayers][nRawTDCs][nRawTDCHits];
+  };
+
+  /** Copy the header and the valid TDC hits of from into to */
+  void copyRawEvent(const RawEvent& from, RawEvent& to);
+
+  /**
+   * Sequence of RawEvents read from a file.
+   *
+   * Reading is staged like SNM::GetStagedEntry: readHeader() fills nevt,
+   * evetime, xydata and xythit, readTDCs() then fills the TDC times of the
+   * channels with hits, so that events can be rejected before their TDC
+   * data is read.
+   */
+  class INOEventSource {
+  public:
+    virtual ~INOEventSource() {}
+
+    /** Number of events in the source */
+    virtual int64_t getEntries() const = 0;
+
+    /** Only the layers with their bit set in layerMask are read, the others have no hits */
+    virtual void setActiveLayers(unsigned layerMask) = 0;
+
+    /** Size of the read cache of the file in bytes, ignored by sources without a cache */
+    virtual void setCacheSize(int64_t /*bytes*/) {}
+
+    /** Read the header stage of entry, false if it could not be read */
+    virtual bool readHeader(int64_t entry) = 0;
+
+    /** Read the TDC stage of the entry of the last readHeader */
+    virtual void readTDCs() = 0;
+
+    /** Read both stages of entry */
+    bool readEntry(int64_t entry)
+    {
+      if (!readHeader(entry)) return false;
+      readTDCs();
+      return true;
+    }
+
+    /** Event filled by the last read */
+    const RawEvent& getEvent() const { return *m_event; }
+
+  protected:
+    INOEventSource();
+
+    /** Buffer of another source, to take its events without a copy */
+    static std::unique_ptr<RawEvent>& getEventBuffer(INOEventSource& source) { return source.m_event; }
+
+    std::unique_ptr<RawEvent> m_event; /**< on the heap, the TDC arrays are large */
+  };
+
+  /**
+   * Events of the SNM tree of a ROOT file.
+   */
+  class INOSNMEventSource : public INOEventSource {
+  public:
+    /** Open the SNM tree of fileName, check isOpen() afterwards */
+    explicit INOSNMEventSource(const std::string& fileName);
+    ~INOSNMEventSource();
+
+    bool isOpen() const { return m_snm != nullptr; }
+
+    int64_t getEntries() const override;
+    void setActiveLayers(unsigned layerMask) override;
+    void setCacheSize(int64_t bytes) override;
+    bool readHeader(int64_t entry) override;
+    void readTDCs() override;
+
+  private:
+    /** Put the branches of the active layers in the TTreeCache */
+    void updateCache();
+
+    TFile* m_file;
+    TTree* m_tree;
+    SNM*   m_snm;
+    int64_t m_cacheSize;
+  };
+
+  /**
+   * Open fileName as a compact hit file (see INOCompactHitFile.h) if it
+   * starts with the compact magic, as an SNM ROOT file otherwise.
+   * @return nullptr if the file cannot be read
+   */
+  std::unique_ptr<INOEventSource> openEventSource(const std::string& fileName);
+
+} // namespace INO
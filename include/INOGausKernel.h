@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+
+#include "INOTimeHistogram.h"
+
+namespace INO {
+
+  /**
+   * Precomputed normalised gauss of fixed sigma on bins of fixed width.
+   *
+   * The bin values are tabulated for nPhases positions of the center inside
+   * its bin and linearly interpolated in between, so that adding a gauss to
+   * a histogram is a plain multiply-add over consecutive bins.
+   */
+  class INOGausKernel {
+  public:
+    INOGausKernel() : m_sigma(0), m_binWidth(0), m_sigmaN(0), m_halfBins(0), m_nPhases(0) {}
+
+    /** Tabulate a gauss of this sigma for bins of binWidth, upto sigmaN sigmas */
+    void configure(double sigma, double binWidth, double sigmaN, int nPhases = 64);
+
+    /** True if the table was built for these values */
+    bool isConfiguredFor(double sigma, double binWidth, double sigmaN) const;
+
+    /** Add (or Subtract) integral times the gauss at center to (or from) the histogram
+     *
+     * Fills the same bins as addGausToHistogram, which are the bins overlapping
+     * [center - sigmaN * sigma, center + sigmaN * sigma].
+     */
+    void add(INOTimeHistogram& hist, double integral, double center, bool isAddition = true) const;
+
+    /** Normalised gauss of unit sigma at u, from a lookup table */
+    static double unitGaus(double u)
+    {
+      double x = (u < 0 ? -u : u) * c_unitStepsPerSigma;
+      int index = int(x);
+      if (index >= c_unitTableSize - 1) return 0;
+      const double* table = getUnitTable();
+      return table[index] + (x - index) * (table[index + 1] - table[index]);
+    }
+
+  private:
+    static const int c_unitStepsPerSigma = 256; /**< table points per sigma */
+    static const int c_unitTableSize = 12 * c_unitStepsPerSigma + 2; /**< table covers upto 12 sigma */
+
+    static const double* getUnitTable();
+
+    double m_sigma;
+    double m_binWidth;
+    double m_sigmaN;
+    int m_halfBins;   /**< bins on each side of the bin containing the center */
+    int m_nPhases;
+    /** (nPhases + 1) rows of 2 * halfBins + 1 bin values, row p has the center at p / nPhases inside its bin */
+    std::vector<double> m_table;
+  };
+
+} // namespace INO
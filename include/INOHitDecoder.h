@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+
+#include "INOStructs.h"
+#include "INOEvent.h"
+#include "INOInstrumentation.h"
+
+namespace INO {
+
+  /** Call f(bit) for every set bit of bits, lowest bit first. */
+  template <class F>
+  inline void forEachSetBit(uint64_t bits, F&& f)
+  {
+    while (bits) {
+      f(__builtin_ctzll(bits));
+      bits &= bits - 1;
+    }
+  }
+
+  /**
+   * Decode the strips and TDC times of an SNM-like event into an INOEvent.
+   *
+   * Event needs the SNM arrays xydata[side][layer], xythit[side][layer][tdc],
+   * xytime and plWidth[side][layer][tdc][hit]. Layers 0..nLayersToDecode-1
+   * are decoded one layer side at a time: first the TDC channels with hits,
+   * then the strips, found by scanning the set bits of xydata.
+   * Times are converted with tdcLeast [ns] and truncated to int, as before.
+   */
+  template <class Event>
+  void decodeEvent(const Event& event, INOEvent& inoEvent, int nLayersToDecode, double tdcLeast)
+  {
+    INO_SCOPED_TIMER("decode");
+    for (int ij = 0; ij < nLayersToDecode; ij++)
+      for (int nj = 0; nj < nSides; nj++) {
+        // setting rawTDCs
+        for (int ntdc = 0; ntdc < nTDCs; ntdc++) {
+          int nTDCHits = event.xythit[nj][ij][ntdc];
+          for (int tc = 0; tc < nTDCHits; tc++) {
+            int rawTDCl = event.xytime[nj][ij][ntdc][tc] * tdcLeast;
+            int rawTDCt = rawTDCl + event.plWidth[nj][ij][ntdc][tc] * tdcLeast;
+            inoEvent.addTDC(TDCId{0, 0, 0, ij, nj, ntdc}, rawTDCl, 0);
+            inoEvent.addTDC(TDCId{0, 0, 0, ij, nj, ntdc}, rawTDCt, 1);
+          }
+        }
+        // setting strip hits
+        forEachSetBit(event.xydata[nj][ij], [&](int kl) {
+          inoEvent.addHit(StripId{0, 0, 0, ij, nj, kl});
+        });
+      }
+  }
+
+} // namespace INO
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+
+#include "INOAllocationCounter.h"
+
+namespace INO {
+
+  /**
+   * Scoped timers and counters for finding where the time of a job goes.
+   *
+   * The macros at the end of this file are the interface. They only do
+   * something if INO_INSTRUMENTATION is defined (cmake -DINO_INSTRUMENTATION=ON),
+   * otherwise they compile to nothing.
+   *
+   * Every thread records into its own tables, which are added to the
+   * global ones when the thread ends, so the threads of a job have to be
+   * joined before writeSummary().
+   */
+  class INOInstrumentation {
+  public:
+    /** Durations [ns] are counted in log-linear bins, 8 per power of two */
+    static const int nDurationBins = 512;
+
+    /** Statistics of one timer */
+    struct TimerRecord {
+      uint64_t calls = 0;
+      uint64_t totalNanoseconds = 0;
+      uint64_t maxNanoseconds = 0;
+      uint64_t allocations = 0;
+      std::vector<uint64_t> durationBins = std::vector<uint64_t>(nDurationBins, 0);
+    };
+
+    static INOInstrumentation& getInstance();
+
+    /** Id of the timer name, the same name gives the same id */
+    int registerTimer(const char* name);
+    /** Id of the counter name, the same name gives the same id */
+    int registerCounter(const char* name);
+
+    /** Add a call of timer id that took nanoseconds and made allocations */
+    void recordTimer(int id, uint64_t nanoseconds, uint64_t allocations);
+    /** Add n to counter id */
+    void addToCounter(int id, int64_t n);
+
+    /**
+     * Write the summary of all timers and counters: wall time, events/s
+     * (from the counter "events"), calls, percentiles and allocations per
+     * call of each timer. CSV if fileName ends with ".csv", JSON otherwise.
+     * @return false if the file could not be written
+     */
+    bool writeSummary(const std::string& fileName);
+
+    /** Bin of a duration in nanoseconds */
+    static int getDurationBin(uint64_t nanoseconds);
+    /** Upper edge of a duration bin in nanoseconds */
+    static uint64_t getDurationBinEdge(int bin);
+
+    /** Add the tables of the calling thread to the global ones */
+    void flushThread();
+
+  private:
+    INOInstrumentation();
+
+    std::chrono::steady_clock::time_point m_start;
+    std::mutex m_mutex;
+    std::vector<std::string> m_timerNames;
+    std::vector<std::string> m_counterNames;
+    std::vector<TimerRecord> m_timers;   /**< of the finished threads */
+    std::vector<int64_t> m_counters;     /**< of the finished threads */
+  };
+
+  /** Records the time and the allocations of the thread between construction and destruction */
+  class INOScopedTimer {
+  public:
+    explicit INOScopedTimer(int id) :
+      m_id(id), m_allocations(getThreadAllocationCount()), m_start(std::chrono::steady_clock::now()) {}
+    ~INOScopedTimer() {
+      auto stop = std::chrono::steady_clock::now();
+      INOInstrumentation::getInstance().recordTimer(
+        m_id, std::chrono::duration_cast<std::chrono::nanoseconds>(stop - m_start).count(),
+        getThreadAllocationCount() - m_allocations);
+    }
+
+  private:
+    int m_id;
+    uint64_t m_allocations;
+    std::chrono::steady_clock::time_point m_start;
+  };
+
+} // namespace INO
+
+#define INO_INSTRUMENTATION_CONCAT2(a, b) a##b
+#define INO_INSTRUMENTATION_CONCAT(a, b) INO_INSTRUMENTATION_CONCAT2(a, b)
+
+#ifdef INO_INSTRUMENTATION
+/** Time the rest of the enclosing scope as timer name */
+#define INO_SCOPED_TIMER(name)                                          \
+  static const int INO_INSTRUMENTATION_CONCAT(inoTimerId, __LINE__) =   \
+    INO::INOInstrumentation::getInstance().registerTimer(name);         \
+  INO::INOScopedTimer INO_INSTRUMENTATION_CONCAT(inoTimer, __LINE__)(INO_INSTRUMENTATION_CONCAT(inoTimerId, __LINE__))
+/** Add n to counter name */
+#define INO_COUNT(name, n)                                              \
+  do {                                                                  \
+    static const int inoCounterId = INO::INOInstrumentation::getInstance().registerCounter(name); \
+    INO::INOInstrumentation::getInstance().addToCounter(inoCounterId, n); \
+  } while (0)
+/** Write the summary to fileName */
+#define INO_WRITE_INSTRUMENTATION(fileName) INO::INOInstrumentation::getInstance().writeSummary(fileName)
+#else
+#define INO_SCOPED_TIMER(name) do {} while (0)
+#define INO_COUNT(name, n) do {} while (0)
+#define INO_WRITE_INSTRUMENTATION(fileName) do {} while (0)
+#endif
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "TVector3.h"
+
+#include "INOStructs.h"
+
+namespace INO {
+
+  /**
+   * Global position of every pixel of the detector.
+   *
+   * The table is built once from the Position table of the calibration
+   * database: the local strip position is shifted by the layer offset and
+   * rotated around X, Y and Z by the layer orientation.
+   */
+  class INOPixelGeometry {
+  public:
+    /** Constructor
+     * @param stripWidth width of a strip [m]
+     * @param layerPitch distance between consecutive layers [m]
+     * @param zShift z of layer 0 [m]
+     * @param invertRotation rotate by the negative of the stored orientation
+     */
+    INOPixelGeometry(double stripWidth, double layerPitch, double zShift,
+                     bool invertRotation = false);
+
+    /** Global position of the centre of a pixel */
+    TVector3 getPosition(const PixelId& pixelId) const;
+
+    /**
+     * Pixel of a layer under the global (x, y). Each quadrant of the layer
+     * has its own position, so the strips are found in the grid of every
+     * quadrant and the nearest pixel of them is taken.
+     * @return false if (x, y) is more than half a strip outside the layer
+     */
+    bool findPixel(const LayerId& layerId, double x, double y, PixelId& pixelId) const;
+
+    double getStripWidth() const { return m_stripWidth; }
+
+  private:
+    TVector3 computePosition(const PixelId& pixelId,
+                             const TVector3& rpcPosition, const TVector3& rpcOrientation) const;
+
+    double m_stripWidth;
+    double m_layerPitch;
+    double m_zShift;
+    double m_rotationSign;
+
+    /** positions indexed by getPixelIndex */
+    std::vector<std::array<double, 3>> m_positions;
+  };
+
+} // namespace INO
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "INOEventSource.h"
+
+namespace INO {
+
+  /**
+   * Reads the events of another source ahead on a background thread.
+   *
+   * The entries first..last of the wrapped source are read in order into a
+   * ring of depth preallocated RawEvents, while the caller processes the
+   * current one. Events rejected by the prefilter only get their header
+   * stage read. The entries have to be requested in increasing order,
+   * skipped entries are dropped. start() can be called again for the next
+   * range.
+   */
+  class INOPrefetchingEventSource : public INOEventSource {
+  public:
+    /** Prefetch from source with a ring of depth events */
+    INOPrefetchingEventSource(std::unique_ptr<INOEventSource> source, int depth);
+    ~INOPrefetchingEventSource();
+
+    int64_t getEntries() const override { return m_source->getEntries(); }
+    /** Forwarded to the wrapped source, only before start() */
+    void setActiveLayers(unsigned layerMask) override { m_source->setActiveLayers(layerMask); }
+    /** Forwarded to the wrapped source, only before start() */
+    void setCacheSize(int64_t bytes) override { m_source->setCacheSize(bytes); }
+    /** Events rejected by prefilter have no TDC data, only before start() */
+    void setPrefilter(const std::function<bool(const RawEvent&)>& prefilter) { m_prefilter = prefilter; }
+
+    /** Start reading the entries first..last on the background thread, ends an earlier range */
+    void start(int64_t first, int64_t last);
+
+    /** Wait for entry, false if it could not be read */
+    bool readHeader(int64_t entry) override;
+    /** Nothing to do, the TDC stage is read in the background */
+    void readTDCs() override {}
+
+    /** Time the caller waited for events [s], large if the job is I/O-bound */
+    double getInputStallSeconds() const { return m_inputStallSeconds; }
+    /** Time the background thread waited for a free buffer [s], large if the job is CPU-bound */
+    double getOutputStallSeconds() const;
+
+  private:
+    /** End the background thread */
+    void stop();
+
+    /** Body of the background thread */
+    void prefetch();
+
+    struct Slot {
+      std::unique_ptr<RawEvent> event;
+      bool isRead;
+    };
+
+    std::unique_ptr<INOEventSource> m_source;
+    std::function<bool(const RawEvent&)> m_prefilter;
+    std::vector<Slot> m_slots;
+
+    std::thread m_thread;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_produced; /**< an event is ready or the thread is done */
+    std::condition_variable m_consumed; /**< a slot is free or the thread has to stop */
+
+    int64_t m_first;          /**< first entry */
+    int64_t m_last;           /**< last entry */
+    int64_t m_nProduced;      /**< entries read into slots */
+    int64_t m_nConsumed;      /**< entries taken by the caller */
+    bool    m_isDone;         /**< background thread has read its last entry */
+    bool    m_isStopping;     /**< the background thread has to stop */
+    double  m_inputStallSeconds;
+    double  m_outputStallSeconds;
+  };
+
+} // namespace INO
@@ -78,6 +78,63 @@ namespace INO {
     }
   };
   
+  /* detector dimensions used to pack ids into dense indices */
+  constexpr int nModules = 1;
+  constexpr int nRows    = 1;
+  constexpr int nColumns = 1;
+  constexpr int nLayers  = 10;
+  constexpr int nSides   = 2;
+  constexpr int nStrips  = 64;
+  constexpr int nTDCs    = 8;
+  constexpr int nLayerIndices = nModules * nRows * nColumns * nLayers;
+  constexpr int nSideIndices  = nLayerIndices * nSides;
+  constexpr int nStripIndices = nSideIndices * nStrips;
+  constexpr int nPixelIndices = nLayerIndices * nStrips * nStrips;
+  constexpr int nTDCIndices   = nSideIndices * nTDCs;
+
+  /** Dense index of a layer, -1 if it is outside the detector. */
+  inline int getLayerIndex(int module, int row, int column, int layer) {
+    if (module < 0 || module >= nModules || row < 0 || row >= nRows ||
+        column < 0 || column >= nColumns || layer < 0 || layer >= nLayers)
+      return -1;
+    return ((module * nRows + row) * nColumns + column) * nLayers + layer;
+  }
+
+  /** Dense index of a layer side, -1 if it is outside the detector. */
+  inline int getSideIndex(const SideId& sideId) {
+    int layerIndex = getLayerIndex(sideId.module, sideId.row, sideId.column, sideId.layer);
+    if (layerIndex < 0 || sideId.side < 0 || sideId.side >= nSides) return -1;
+    return layerIndex * nSides + sideId.side;
+  }
+
+  /** Dense index of a strip, -1 if it is outside the detector.
+   * The ordering is the same as StripId::operator<.
+   */
+  inline int getStripIndex(const StripId& stripId) {
+    int sideIndex = getSideIndex({stripId.module, stripId.row, stripId.column,
+                                  stripId.layer, stripId.side});
+    if (sideIndex < 0 || stripId.strip < 0 || stripId.strip >= nStrips) return -1;
+    return sideIndex * nStrips + stripId.strip;
+  }
+
+  /** Dense index of a TDC channel, -1 if it is outside the detector. */
+  inline int getTDCIndex(const TDCId& tdcId) {
+    int sideIndex = getSideIndex({tdcId.module, tdcId.row, tdcId.column,
+                                  tdcId.layer, tdcId.side});
+    if (sideIndex < 0 || tdcId.tdc < 0 || tdcId.tdc >= nTDCs) return -1;
+    return sideIndex * nTDCs + tdcId.tdc;
+  }
+
+  /** Dense index of a pixel, -1 if it is outside the detector. */
+  inline int getPixelIndex(const PixelId& pixelId) {
+    int layerIndex = getLayerIndex(pixelId.module, pixelId.row, pixelId.column, pixelId.layer);
+    if (layerIndex < 0 ||
+        pixelId.strip[0] < 0 || pixelId.strip[0] >= nStrips ||
+        pixelId.strip[1] < 0 || pixelId.strip[1] >= nStrips)
+      return -1;
+    return (layerIndex * nStrips + pixelId.strip[0]) * nStrips + pixelId.strip[1];
+  }
+
   struct Hit {
     StripId stripId;
     std::vector<double> rawTimes[2]; // leading and trailing
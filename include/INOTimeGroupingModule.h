@@ -11,10 +11,26 @@
 #include <TMath.h>
 
 #include "INOEvent.h"
+#include "INOTimeHistogram.h"
+#include "INOGausKernel.h"
+#include "INOClustering.h"
 
 
 namespace INO {
 
+  /** Engines estimating (integral, center, sigma) of a peak in the peak-search. */
+  enum PeakEstimator {
+    c_gausFit     = 0, /**< TF1 Gauss fit with Minuit */
+    c_moments     = 1, /**< weighted moments in the fit range, corrected for the truncation */
+    c_logParabola = 2  /**< parabola through the logarithm of the maximum bin and its neighbours */
+  };
+
+  /** Ways of forming the time groups. */
+  enum GroupingEngine {
+    c_histogramPeaks = 0, /**< peak search in the histogram of gauss-shaped strip times */
+    c_sortAndSweep   = 1  /**< sweep over the sorted strip times, splitting at gaps */
+  };
+
   /**
    * structure containing the relevant information
    * of TimeGrouping module
@@ -22,6 +38,15 @@ namespace INO {
   struct TimeGroupingParameters {
     /** Expected range of svd time histogram [ns]. */
     Float_t tRange[2];
+    /** Engine used to form the groups, see GroupingEngine. */
+    Int_t   groupingEngine;
+    /** Group the clusters of adjacent strips, each time of a cluster once, instead of the times of
+     *  every strip; all strips of a cluster get the groups of the cluster. */
+    Bool_t  useStripClusters;
+    /** Sort-and-sweep: a new group starts after a gap larger than this between strip times [ns]. */
+    Float_t sweepMaxGap;
+    /** Sort-and-sweep: a new group starts when a group would get wider than this [ns]. */
+    Float_t sweepMaxWidth;
     /** Time bin width is 1/rebinningFactor [ns]. */
     Float_t   rebinningFactor;
     /** Number of Gaussian sigmas used to fill the time histogram for each cluster. */
@@ -30,6 +55,8 @@ namespace INO {
     Float_t limitSigma[2];
     /** Half width of the range in which the fit for the peak-search is performed [ns]. */
     Float_t fitRangeHalfWidth;
+    /** Engine used to estimate the peak parameters in the peak-search, see PeakEstimator. */
+    Int_t   peakEstimator;
     /** Remove upto this sigma of fitted gauss from histogram. */
     Float_t removeSigmaN;
     /** Minimum fraction of candidates in a peak (wrt to the highest peak) considered for fitting in the peak-search. */
@@ -73,10 +100,22 @@ namespace INO {
     INOTimeGroupingModule(std::shared_ptr<INOEvent> data);
 
     /** EventWise jobs
-     * Grouping of Clusters is performed here
+     * Grouping of Clusters is performed here.
+     * The module can be reused for every event refilled into the same INOEvent.
      */
     void process();
 
+    /** Process the hits of data from now on, the buffers of the module are kept */
+    void setEvent(std::shared_ptr<INOEvent> data) { m_inoEvent = std::move(data); }
+
+    /** Parameters used by the module */
+    const TimeGroupingParameters& getParameters() const { return m_usedPars; }
+    /** Change the parameters, tRange is always taken from the event */
+    void setParameters(const TimeGroupingParameters& pars) { m_usedPars = pars; }
+
+    /** Clusters of the last event, only filled with useStripClusters */
+    const std::vector<StripCluster>& getClusters() const { return m_clusters; }
+
   protected:
 
     /**
@@ -89,6 +128,60 @@ namespace INO {
      */
     TimeGroupingParameters m_usedPars;
 
+    /**
+     * time histogram, its buffer is reused for every event.
+     */
+    INOTimeHistogram m_timeHistogram;
+
+    /**
+     * histogram holding the bins around a peak for the TF1 fit.
+     */
+    TH1D m_fitHistogram;
+
+    /**
+     * gauss of sigma clsSigma used to fill the time histogram,
+     * rebuilt when clsSigma, fillSigmaN or the bin width change.
+     */
+    INOGausKernel m_fillKernel;
+
+    /**
+     * clusters of adjacent strips of the event with useStripClusters, reused for every event.
+     */
+    std::vector<StripCluster> m_clusters;
+
+    /**
+     * times of the clusters, see collectClusterTimes, one after the other;
+     * those of cluster k start at m_clusterTimeOffsets[k].
+     */
+    std::vector<double> m_clusterTimes;
+    std::vector<int> m_clusterTimeOffsets;
+
+    /**
+     * times of one cluster, reused for every cluster.
+     */
+    std::vector<double> m_oneClusterTimes;
+
+    /**
+     * strip times of the event for the sort-and-sweep engine, reused for every event.
+     */
+    std::vector<double> m_sortedTimes;
+
+    /**
+     * sorted edges of the group acceptance ranges, reused for every event.
+     */
+    std::vector<double> m_acceptanceEdges;
+
+    /**
+     * bitmask of the groups accepting each cell of m_acceptanceEdges.
+     * Cell 2k+1 is the edge k itself, cell 2k is between edges k-1 and k.
+     */
+    std::vector<uint64_t> m_cellGroupMasks;
+
+    /**
+     * cell of each time of the current hit.
+     */
+    std::vector<int> m_timeCells;
+
     // helper functions
 
     /** Create Histogram and Fill cluster time in it
@@ -96,7 +189,7 @@ namespace INO {
      * 1. Optimize the range of the histogram and declare it
      * 2. fill the histogram shaping each cluster with a normalised gaussian G(cluster time, resolution)
      */
-    void createAndFillHistorgram(TH1D& hist);
+    void createAndFillHistorgram(INOTimeHistogram& hist);
 
     /** Find Gaussian components in a Histogram
      *
@@ -106,7 +199,33 @@ namespace INO {
      * 4. Gauss peak is removed from histogram
      * 5. Process is repeated until a few criteria are met.
      */
-    void searchGausPeaksInHistogram(TH1D& hist, std::vector<GroupInfo>& groupInfoVector);
+    void searchGausPeaksInHistogram(INOTimeHistogram& hist, std::vector<GroupInfo>& groupInfoVector);
+
+    /** Estimate the peak around maxBin without a fit
+     *
+     * Uses the bins within fitRangeHalfWidth of the maximum bin, either with
+     * truncation-corrected weighted moments or with a parabola through the
+     * logarithm of the maximum bin and its neighbours.
+     * @return 0 if the estimate is valid, like the status of TH1::Fit
+     */
+    int estimatePeakWithoutFit(const INOTimeHistogram& hist, int maxBin, double pars[3]);
+
+    /** Fit a gauss to the peak at maxBin
+     *
+     * The bins around the peak are copied to m_fitHistogram, which is fitted
+     * in the range [-fitRangeHalfWidth, fitRangeHalfWidth].
+     * @return status of TH1::Fit
+     */
+    int fitPeak(const INOTimeHistogram& hist, int maxBin, double maxPar0, double pars[3]);
+
+    /** Form groups from the sorted strip times
+     *
+     * 1. Strip times are sorted
+     * 2. A group is closed at a gap larger than sweepMaxGap or when it would exceed sweepMaxWidth
+     * 3. Each group is stored as (number of times, mean, sigma), sigma includes clsSigma
+     * 4. Groups smaller than fracThreshold of the largest one are dropped, at most maxGroups are kept
+     */
+    void sweepSortedTimes(std::vector<GroupInfo>& groupInfoVector);
 
     /*! increase the size of vector to max, this helps in sorting */
     void resizeToMaxSize(std::vector<GroupInfo>& groupInfoVector)
@@ -131,12 +250,28 @@ namespace INO {
 
     /** Assign groupId to the clusters
      *
-     * 1. Looped over all the groups
-     * 2. Acceptance time-range is computed using the center and m_acceptSigmaN
-     * 3. Looped over all the clusters
-     * 4. Clusters in the range is assigned the respective groupId
+     * 1. Acceptance time-range of each group is computed using the center and m_acceptSigmaN
+     * 2. The range edges are sorted and each cell between them gets the bitmask of the groups covering it
+     * 3. Looped once over all the clusters, the cell of each time is found by binary search
+     * 4. Clusters are assigned the groupIds of their cell, in increasing groupId
      */
-    void assignGroupIdsToClusters(TH1D& hist, std::vector<GroupInfo>& groupInfoVector);
+    void assignGroupIdsToClusters(double tRangeLow, double tRangeHigh, std::vector<GroupInfo>& groupInfoVector);
+
+    /** Assign the groups accepting the times to the strip, with the cells of assignGroupIdsToClusters */
+    void assignGroupIdsToTimes(const StripId& stripId, const double* stripTimes, int nTimes,
+                               double tRangeLow, double tRangeHigh, const std::vector<GroupInfo>& groupInfoVector);
+
+    /** Call f(time) for every time that is grouped, of the strips or of the clusters */
+    template <class F>
+    void forEachGroupedTime(F&& f) const
+    {
+      if (m_usedPars.useStripClusters) {
+        for (auto clusterTime : m_clusterTimes) f(clusterTime);
+      } else {
+        for (const auto& hit : m_inoEvent->getHitRange())
+          for (auto stripTime : hit.calibratedTimes[0]) f(stripTime);
+      }
+    }
 
   };
 
@@ -173,6 +308,31 @@ namespace INO {
   }
 
 
+  /** Add (or Subtract) a Gaussian to (or from) an INOTimeHistogram
+   *
+   * The gauss is calculated upto the sigmaN passed to the function.
+   * Use INOGausKernel instead when sigma and the bin width do not change.
+   */
+  inline void addGausToHistogram(INOTimeHistogram& hist,
+                                 const double& integral, const double& center, const double& sigma,
+                                 const double& sigmaN, const bool& isAddition = true)
+  {
+    int startBin = hist.findBin(center - sigmaN * sigma);
+    int   endBin = hist.findBin(center + sigmaN * sigma);
+    if (startBin < 1) startBin = 1;
+    if (endBin > (hist.getNBins())) endBin = hist.getNBins();
+    if (startBin > endBin) return;
+
+    // the gauss is taken from the unit sigma lookup table
+    double* bins = hist.getBinRange(startBin, endBin);
+    double weight = (isAddition ? integral : -integral) / sigma;
+    double u0 = (hist.getBinCenter(startBin) - center) / sigma;
+    double du = hist.getBinWidth() / sigma;
+    for (int ijx = 0; ijx <= endBin - startBin; ijx++)
+      bins[ijx] += weight * INOGausKernel::unitGaus(u0 + ijx * du);
+  }
+
+
   /**  Subtract a Gaussian from a histogram
    *
    * The gauss is calculated upto the sigmaN passed to the function.
@@ -184,4 +344,12 @@ namespace INO {
     addGausToHistogram(hist, integral, center, sigma, sigmaN, false);
   }
 
+  /**  Subtract a Gaussian from an INOTimeHistogram */
+  inline void subtractGausFromHistogram(INOTimeHistogram& hist,
+                                        const double& integral, const double& center, const double& sigma,
+                                        const double& sigmaN)
+  {
+    addGausToHistogram(hist, integral, center, sigma, sigmaN, false);
+  }
+
 } // end namespace Belle2
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+namespace INO {
+
+  /**
+   * Fixed-width time histogram with a persistent bin buffer.
+   *
+   * It replaces the TH1D of the time grouping: the buffer is kept between
+   * events and only the blocks of bins touched since the last reset are
+   * cleared or scanned for the maximum. Bin numbering and bin edges follow
+   * TH1 (bins 1..nBins, 0 is underflow and nBins+1 overflow).
+   */
+  class INOTimeHistogram {
+  public:
+    INOTimeHistogram() : m_nBins(0), m_low(0), m_high(0), m_binWidth(0) {}
+
+    /** Set the binning and clear the bins filled since the last reset. */
+    void reset(int nBins, double low, double high);
+
+    int getNBins() const { return m_nBins; }
+    double getLowEdge() const { return m_low; }
+    double getHighEdge() const { return m_high; }
+    double getBinWidth() const { return m_binWidth; }
+
+    /** Bin containing x, same convention as TAxis::FindBin */
+    int findBin(double x) const {
+      if (x < m_low) return 0;
+      if (!(x < m_high)) return m_nBins + 1;
+      return 1 + int(m_nBins * (x - m_low) / (m_high - m_low));
+    }
+    double getBinLowEdge(int bin) const { return m_low + (bin - 1) * m_binWidth; }
+    double getBinCenter(int bin) const { return m_low + (bin - 1) * m_binWidth + 0.5 * m_binWidth; }
+
+    double getBinContent(int bin) const {
+      if (bin < 1 || bin > m_nBins) return 0;
+      return m_contents[bin - 1];
+    }
+    void setBinContent(int bin, double content) {
+      if (bin < 1 || bin > m_nBins) return;
+      touch(bin, bin);
+      m_contents[bin - 1] = content;
+    }
+
+    /** Bins firstBin..lastBin as a raw array, the range is marked as filled.
+     * @return pointer to the content of firstBin
+     */
+    double* getBinRange(int firstBin, int lastBin) {
+      touch(firstBin, lastBin);
+      return &m_contents[firstBin - 1];
+    }
+
+    /** First bin with the highest content, like TH1::GetMaximumBin */
+    int getMaximumBin() const;
+
+  private:
+    static const int c_blockShift = 8; /**< blocks of 256 bins */
+
+    void touch(int firstBin, int lastBin) {
+      for (int block = (firstBin - 1) >> c_blockShift; block <= (lastBin - 1) >> c_blockShift; block++)
+        m_touchedBlocks[block >> 6] |= uint64_t(1) << (block & 63);
+    }
+    bool isTouched(int block) const {
+      return (m_touchedBlocks[block >> 6] >> (block & 63)) & 1;
+    }
+
+    int m_nBins;
+    double m_low;
+    double m_high;
+    double m_binWidth;
+    std::vector<double> m_contents;          /**< bin contents, only grows */
+    std::vector<uint64_t> m_touchedBlocks;   /**< bitmap of the blocks filled since the last reset */
+  };
+
+} // namespace INO
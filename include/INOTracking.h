@@ -0,0 +1,224 @@
+#pragma once
+
+#include <vector>
+
+#include "TVector2.h"
+#include "TVector3.h"
+
+#include "INOStructs.h"
+#include "INOEvent.h"
+#include "INOPixelGeometry.h"
+#include "INOEfficiencyAccumulator.h"
+
+namespace INO {
+
+  /** Points of a straight line fit as arrays, not owned */
+  struct LineFitPoints {
+    int           n = 0;
+    const double* z = nullptr;
+    const double* value[nSides] = {};    /**< x and y */
+    const double* variance[nSides] = {};
+    const bool*   isUsed = nullptr;      /**< points in the fit, all if nullptr */
+  };
+
+  /**
+   * Lines of x and y against z of fitLine. Sides without a line have all
+   * values -10000, as in LinearVectorFit.
+   */
+  struct LineFitResult {
+    double slope[nSides];
+    double inter[nSides];
+    double chi2[nSides];    /**< sums over the used points */
+    double errcst[nSides];  /**< covariance of the intercept and the slope */
+    double errcov[nSides];
+    double errlin[nSides];
+
+    double getValue(int side, double z) const { return slope[side] * z + inter[side]; }
+    double getVariance(int side, double z) const {
+      return errcst[side] + 2 * errcov[side] * z + errlin[side] * z * z;
+    }
+  };
+
+  /**
+   * Straight line fit of x and y against z, each side on its own, without
+   * heap allocations. The sums are taken in the order of LinearVectorFit,
+   * so the lines and the extrapolations are the same to the last bit.
+   */
+  void fitLine(bool isTime, const LineFitPoints& points, LineFitResult& fit);
+
+  /**
+   * Growing arrays behind the LineFitPoints of one fit, reused from event
+   * to event so that they stop allocating once they have the largest size.
+   */
+  struct LineFitBuffer {
+    std::vector<double> z;
+    std::vector<double> value[nSides];
+    std::vector<double> variance[nSides];
+
+    void clear();
+    void add(const TVector3& position, double varianceX, double varianceY);
+    LineFitPoints getPoints() const;
+  };
+
+  /**
+   * Tracks of at most one point per layer, fitted together by fitLines.
+   *
+   * Every array is indexed [point][track] with the track innermost, so
+   * that the fit runs over the tracks in vector registers; the loops over
+   * the tracks are marked omp simd, which -fopenmp-simd turns on. Points with an
+   * infinite variance add exact zeros to the sums, which makes them the
+   * same as points left out, and reset() sets all variances to infinity.
+   */
+  struct LineFitBatch {
+    static constexpr int width = 8;   /**< tracks in a batch */
+    static constexpr int nPoints = nLayers;
+
+    double z[nPoints][width];
+    double value[nSides][nPoints][width];
+    double variance[nSides][nPoints][width];
+
+    double slope[nSides][width];
+    double inter[nSides][width];
+    double chi2[nSides][width];
+    double errcst[nSides][width];
+    double errcov[nSides][width];
+    double errlin[nSides][width];
+
+    void reset();
+    void setPoint(int track, int point, const TVector3& position, double varianceX, double varianceY);
+  };
+
+  /** fitLine of each track of batch, with the same results */
+  void fitLines(bool isTime, LineFitBatch& batch);
+
+  /**
+   * Straight line fit of x and y against z, each side on its own.
+   *
+   * The points of the layers with occulay false are left out, all are used
+   * if occulay is empty; poserr are the variances of the points. For isTime
+   * the slope is fixed to -1/c and only the intercept is fitted.
+   * ext and exterr are the fitted positions and their variances at the z
+   * of every point, chi2 the sums over the used points. Copies the points
+   * for fitLine, which new code calls directly.
+   */
+  void LinearVectorFit(bool                   isTime,
+                       std::vector<TVector3>  pos,
+                       std::vector<TVector2>  poserr,
+                       std::vector<bool>      occulay,
+                       TVector2              &slope,
+                       TVector2              &inter,
+                       TVector2              &chi2,
+                       std::vector<TVector3> &ext,
+                       std::vector<TVector3> &exterr);
+
+  /**
+   * Sums of the straight line fit of LinearVectorFit, kept so that points
+   * can be taken out again.
+   *
+   * Removing the points of one layer from the sums of all layers gives the
+   * fit without that layer in O(1), so the unbiased extrapolations to each
+   * layer of an event cost about one fit instead of one fit per layer.
+   */
+  class LinearFitSums {
+  public:
+    /** Add the coordinate value of side at z, with its variance */
+    void add(int side, double z, double value, double variance);
+    /** Take out a coordinate added before, with the same arguments */
+    void remove(int side, double z, double value, double variance);
+
+    /** Number of coordinates of side in the sums */
+    int getNPoints(int side) const { return m_nPoints[side]; }
+
+    /**
+     * Fitted line of side, as LinearVectorFit with isTime false.
+     * @return false with fewer than two points or all at one z
+     */
+    bool getLine(int side, double& slope, double& inter) const;
+
+    /** Fitted coordinate of side at z and its variance, false as getLine */
+    bool extrapolate(int side, double z, double& value, double& variance) const;
+
+  private:
+    double m_szxy[nSides] = {};
+    double m_sz[nSides] = {};
+    double m_sxy[nSides] = {};
+    double m_sn[nSides] = {};
+    double m_sz2[nSides] = {};
+    int m_nPoints[nSides] = {};
+  };
+
+  /**
+   * Pixels of the strips in time group 0: every x strip with every y strip
+   * of the same layer, sides with more than 5 strips are skipped.
+   * @return false if fewer than 10 sides have group 0 hits
+   */
+  bool formPixels(const INOEvent& inoEvent, std::vector<PixelId>& allPixels);
+
+  /** Search of the pixels of one muon among all pixels of an event */
+  struct TrackFindingParameters {
+    /** A pixel belongs to the track if both of its coordinates are at most this far from it [m] */
+    double road = 0.06;
+    /** Least number of layers with a pixel of the track, a line needs 2 */
+    int minLayers = 5;
+    /** Largest number of pixel pairs of two seed layers, the pairs of layers with more are not tried */
+    int maxSeedPairs = 64;
+  };
+
+  /** Pixels of one layer that findTrack looks at, layers with more are left out */
+  const int maxTrackLayerPixels = 25;
+
+  /**
+   * Pixels of one track among pixels, as listed by formPixels, at most one
+   * per layer of the stack.
+   *
+   * The seed layers are the two layers with the fewest pixels in each
+   * half of the stack. Every pair of pixels of a top and a bottom seed
+   * layer gives a line, and each layer adds its pixel nearest to the line
+   * within the road. The candidate with the most layers, then with the
+   * smallest sum of squared distances, is fitted and its pixels are chosen
+   * again around the fit. At most 4 maxSeedPairs candidates of nLayers
+   * maxTrackLayerPixels distances are tried whatever the number of pixels,
+   * so noisy events cost a bounded time.
+   * @return false if no candidate has minLayers layers, or none was tried
+   */
+  bool findTrack(const std::vector<PixelId>& pixels, const INOPixelGeometry& pixelGeometry,
+                 const TrackFindingParameters& pars, std::vector<PixelId>& trackPixels);
+
+  /** Selection of the tracks for the efficiency of a layer */
+  struct EfficiencyParameters {
+    /** Bit per layer, the layers whose efficiency is measured */
+    unsigned testLayerMask = 0xf;
+    /** A hit matches if its strip centre is at most this far from the track [m] */
+    double road = 0.06;
+    /** Least number of other layers in the track fit, on each side */
+    int minFitLayers = 5;
+    /** Sides with more strips, or with strips that are not adjacent, are left out of the fit */
+    int maxClusterStrips = 3;
+  };
+
+  /**
+   * Test layer with the track fitted to the other layers of its stack.
+   *
+   * Each side of another layer whose time group 0 strips form one cluster
+   * of at most maxClusterStrips strips adds the cluster centre to the fit
+   * of its coordinate; the sides furthest from the track are dropped
+   * while they are outside the road. The track is extrapolated to the
+   * layer and each side passes if one of its strips in time group 0 is
+   * within the road.
+   * @return false if the fit has too few layers or the track misses the layer
+   */
+  bool probeLayer(const INOEvent& inoEvent, const INOPixelGeometry& pixelGeometry,
+                  const LayerId& layerId, const EfficiencyParameters& pars, EfficiencyProbe& probe);
+
+  /**
+   * probeLayer for every layer of pars.testLayerMask in the stack of
+   * stackId, whose layer is not used. The sides of all layers are summed
+   * once and each layer under test is taken out of the sums again, see
+   * LinearFitSums.
+   * @return the number of probes added to probes
+   */
+  int probeLayers(const INOEvent& inoEvent, const INOPixelGeometry& pixelGeometry,
+                  const LayerId& stackId, const EfficiencyParameters& pars,
+                  std::vector<EfficiencyProbe>& probes);
+
+} // namespace INO
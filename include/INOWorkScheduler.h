@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+namespace INO {
+
+  /** Entries first..last of the input file fileIndex */
+  struct WorkChunk {
+    int     fileIndex;
+    int64_t first;
+    int64_t last;
+  };
+
+  /**
+   * Hands out chunks of entry ranges to worker threads with work stealing.
+   *
+   * The ranges are split by entry count into one contiguous share per
+   * worker, so that each worker starts on its own files. A worker takes
+   * its chunks from the front of its share, a quarter of what it still
+   * owns but at least minChunk and at most maxChunk entries, so the chunks
+   * get smaller towards the end. A worker without work steals the back
+   * half of the share of the worker with the most entries left.
+   */
+  class INOWorkScheduler {
+  public:
+    /** Distribute ranges over nWorkers workers */
+    INOWorkScheduler(const std::vector<WorkChunk>& ranges, int nWorkers,
+                     int64_t minChunk = 500, int64_t maxChunk = 20000);
+
+    int getNWorkers() const { return m_queues.size(); }
+
+    /** Next chunk of worker, false when all entries are handed out */
+    bool next(int worker, WorkChunk& chunk);
+
+    /** Number of successful steals */
+    int64_t getNSteals() const { return m_nSteals; }
+
+  private:
+    struct Queue {
+      std::mutex mutex;
+      std::deque<WorkChunk> ranges;       /**< share of the worker, in entry order */
+      std::atomic<int64_t> nEntries{0};   /**< entries in ranges, read without the lock to pick a victim */
+    };
+
+    /** Move the back half of the share of the busiest other worker to worker, false if there is none */
+    bool steal(int worker);
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    int64_t m_minChunk;
+    int64_t m_maxChunk;
+    std::atomic<int64_t> m_nSteals;
+  };
+
+} // namespace INO
@@ -13,6 +13,8 @@
 #include <TFile.h>
 #include <TString.h>
 
+#include <functional>
+
 // Header file for the classes stored in the TTree if any.
 
 // Fixed size dimensions of array or collections stored in the TTree if any.
@@ -37,6 +39,10 @@ class SNM {
   TBranch        *b_xythit[2][12][8];   //!
   TBranch        *b_xytime[2][12][8];   //!
   TBranch        *b_plWidth[2][12][8];   //!
+
+  // Staged reading
+  UInt_t          fActiveLayers;  //!bit ij set if layer ij is read
+  Long64_t        fStagedEntry;   //!entry in the current tree of the last GetHeaderEntry
   
   SNM(TTree *tree=0);
   virtual ~SNM();
@@ -47,12 +53,20 @@ class SNM {
   virtual void     Loop();
   virtual Bool_t   Notify();
   virtual void     Show(Long64_t entry = -1);
+
+  // Staged reading: the small branches of an event are read first, the
+  // TDC time and width arrays only for the channels with hits and only
+  // for events accepted by the prefilter.
+  virtual void     SetActiveLayers(UInt_t layerMask);
+  virtual Int_t    GetHeaderEntry(Long64_t entry);
+  virtual Int_t    GetTDCEntry();
+  virtual Bool_t   GetStagedEntry(Long64_t entry, const std::function<Bool_t(const SNM&)>& prefilter = nullptr);
 };
 
 #endif
 
 #ifdef SNM_cxx
-SNM::SNM(TTree *tree) : fChain(0) 
+SNM::SNM(TTree *tree) : fChain(0), fActiveLayers(0xFFF), fStagedEntry(-1) 
 {
   // if parameter tree is not specified (or zero), connect the file
   // used to generate this class and read the Tree.
@@ -0,0 +1,116 @@
+// Add the efficiency counts of grouping-and-efficiency output files and
+// compute the efficiencies with Clopper-Pearson intervals.
+//
+//   merge-efficiency <output file> <input files>... [--level=CL]
+//
+// Each input may be a glob pattern or @list. The output gets the summed
+// counts in "Efficiency", as written by grouping-and-efficiency, so it
+// can be merged again, and TEfficiency objects of the layers, the sides
+// and the cells of every layer in "EfficiencyResults". The layer and side
+// efficiencies are printed with their intervals (default CL 0.682689).
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+#include "TFile.h"
+#include "TDirectory.h"
+#include "TH1D.h"
+#include "TH2D.h"
+#include "TEfficiency.h"
+
+#include "INOEfficiencyAccumulator.h"
+#include "INOCommandLine.h"
+
+using namespace std;
+
+
+/** Efficiency of passed over total, Clopper-Pearson intervals with level */
+void writeEfficiency(TH1* passed, TH1* total, const char* name, double level) {
+  TEfficiency efficiency(*passed, *total);
+  efficiency.SetName(name);
+  efficiency.SetStatisticOption(TEfficiency::kFCP);
+  efficiency.SetConfidenceLevel(level);
+  efficiency.Write();
+}
+
+
+int main(int argc, char** argv) {
+
+  auto options = INO::takeOptions(argc, argv, {"level"});
+  if (argc < 3) {
+    cout << "usage: " << argv[0] << " <output file> <input files>... [--level=CL]" << endl;
+    return 1;
+  }
+  double level = INO::getDoubleOption(options, "level", 0.682689);
+
+  INO::INOEfficiencyAccumulator efficiency;
+  int nFiles = 0;
+  for (int ij = 2; ij < argc; ij++)
+    for (const std::string& fileName : INO::expandFileList(argv[ij])) {
+      TFile* file = TFile::Open(fileName.c_str(), "read");
+      if (!file || file->IsZombie()) {
+        cerr << "Error: cannot open " << fileName << endl;
+        delete file;
+        return 1;
+      }
+      TDirectory* directory = file->GetDirectory("Efficiency");
+      if (!directory || !efficiency.read(directory)) {
+        cerr << "Error: no efficiency counts in " << fileName << endl;
+        file->Close();
+        delete file;
+        return 1;
+      }
+      file->Close();
+      delete file;
+      nFiles++;
+    }
+
+  TFile* fileOut = TFile::Open(argv[1], "recreate");
+  if (!fileOut || fileOut->IsZombie()) {
+    cerr << "Error: cannot create " << argv[1] << endl;
+    return 1;
+  }
+  efficiency.write(fileOut->mkdir("Efficiency"));
+
+  // the same histograms again, read back for the TEfficiency objects
+  TDirectory* counts = fileOut->GetDirectory("Efficiency");
+  TDirectory* results = fileOut->mkdir("EfficiencyResults");
+  results->cd();
+  for (std::string name : {"layer", "side"}) {
+    TH1* passed = nullptr;
+    TH1* total = nullptr;
+    counts->GetObject((name + "Passed").c_str(), passed);
+    counts->GetObject((name + "Total").c_str(), total);
+    if (passed && total) writeEfficiency(passed, total, (name + "Efficiency").c_str(), level);
+  }
+  for (int layerIndex = 0; layerIndex < INO::nLayerIndices; layerIndex++) {
+    TH1* passed = nullptr;
+    TH1* total = nullptr;
+    counts->GetObject(("cellPassed_" + std::to_string(layerIndex)).c_str(), passed);
+    counts->GetObject(("cellTotal_" + std::to_string(layerIndex)).c_str(), total);
+    if (passed && total)
+      writeEfficiency(passed, total, ("cellEfficiency_" + std::to_string(layerIndex)).c_str(), level);
+  }
+  fileOut->Close();
+
+  cout << " files " << nFiles << " | probes " << efficiency.getNProbes() << " | CL " << level << endl;
+  cout << std::fixed << std::setprecision(4);
+  for (int layer = 0; layer < INO::nLayers; layer++) {
+    const INO::EfficiencyCounts& layerCounts = efficiency.getLayerCounts({0, 0, 0, layer});
+    if (!layerCounts.total) continue;
+    double low, high;
+    layerCounts.getInterval(level, low, high);
+    cout << " layer " << layer << " " << layerCounts.getEfficiency()
+         << " [" << low << ", " << high << "] " << layerCounts.passed << "/" << layerCounts.total;
+    for (int side = 0; side < INO::nSides; side++) {
+      const INO::EfficiencyCounts& sideCounts = efficiency.getSideCounts({0, 0, 0, layer, side});
+      sideCounts.getInterval(level, low, high);
+      cout << " | " << (side ? "y " : "x ") << sideCounts.getEfficiency()
+           << " [" << low << ", " << high << "]";
+    }
+    cout << endl;
+  }
+  return 0;
+}
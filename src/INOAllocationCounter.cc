@@ -0,0 +1,50 @@
+#include "INOAllocationCounter.h"
+
+#ifdef INO_ALLOCATION_COUNTER
+
+#include <cstdlib>
+#include <new>
+
+// The global operator new is replaced to count heap allocations.
+// Each thread counts its own, so threads allocating at the same time do
+// not contend for a shared counter.
+
+// constant initialized, so it can be used by new before anything else runs
+static thread_local uint64_t threadAllocationCount = 0;
+
+uint64_t INO::getThreadAllocationCount() {
+  return threadAllocationCount;
+}
+
+void* operator new(std::size_t size) {
+  threadAllocationCount++;
+  if (size == 0) size = 1;
+  while (true) {
+    if (void* ptr = std::malloc(size)) return ptr;
+    std::new_handler handler = std::get_new_handler();
+    if (!handler) throw std::bad_alloc();
+    handler();
+  }
+}
+
+void* operator new[](std::size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+  std::free(ptr);
+}
+
+#endif // INO_ALLOCATION_COUNTER
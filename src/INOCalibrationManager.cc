@@ -2,14 +2,22 @@
 #include <sstream>
 #include <fstream>
 #include <vector>
+#include <algorithm>
 
 using namespace INO;
 
-INOCalibrationManager::INOCalibrationManager() {
+// value returned when a strip has no entry in StripTimeDelay
+static const double defaultStripTimeDelay = -265;
+
+INOCalibrationManager::INOCalibrationManager()
+  : stripTimeDelays(nStripIndices, defaultStripTimeDelay),
+    isStripTimeDelayCacheValid(false) {
   if (sqlite3_open("calibration.db", &db) != SQLITE_OK)
     std::cerr << "Error opening database!" << std::endl;
-  else
+  else {
     initializeDatabase();
+    loadStripTimeDelays();
+  }
 }
 
 INOCalibrationManager::~INOCalibrationManager() {
@@ -36,6 +44,7 @@ INOCalibrationManager& INOCalibrationManager::getInstance() {
 }
 
 void INOCalibrationManager::setStripTimeDelay(const StripId& stripId, double value) {
+  std::lock_guard<std::mutex> lock(dbMutex);
   sqlite3_busy_timeout(db, 5000);
 
   std::string sql = "INSERT OR REPLACE INTO StripTimeDelay (Module, Row, Column, Layer, Side, Strip, Value) "
@@ -51,6 +60,11 @@ void INOCalibrationManager::setStripTimeDelay(const StripId& stripId, double val
     sqlite3_bind_double(stmt, 7, value);
     if (sqlite3_step(stmt) != SQLITE_DONE)
       std::cerr << "Error inserting/updating calibration data: " << sqlite3_errmsg(db) << std::endl;
+    else {
+      // keep the cache consistent with what was written
+      int index = getStripIndex(stripId);
+      if (index >= 0) stripTimeDelays[index] = value;
+    }
     sqlite3_finalize(stmt);
   } else {
     std::cerr << "SQL error in setStripTimeDelay: " << sqlite3_errmsg(db) << std::endl;
@@ -58,13 +72,25 @@ void INOCalibrationManager::setStripTimeDelay(const StripId& stripId, double val
 }
 
 double INOCalibrationManager::getStripTimeDelay(const StripId& stripId) const {
+  int index = getStripIndex(stripId);
+  if (index < 0) return queryStripTimeDelay(stripId);
+  if (!isStripTimeDelayCacheValid.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> lock(dbMutex);
+    // another thread may have loaded the cache while this one waited
+    if (!isStripTimeDelayCacheValid.load(std::memory_order_relaxed)) loadStripTimeDelays();
+  }
+  return stripTimeDelays[index];
+}
+
+double INOCalibrationManager::queryStripTimeDelay(const StripId& stripId) const {
+  std::lock_guard<std::mutex> lock(dbMutex);
   sqlite3_busy_timeout(db, 5000);
 
   std::string sql = "SELECT Value FROM StripTimeDelay WHERE "
                     "Module=? AND Row=? AND Column=? "
                     "AND Layer=? AND Side=? AND Strip=?;";
   sqlite3_stmt* stmt;
-  double value = -265;
+  double value = defaultStripTimeDelay;
   if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
     sqlite3_bind_int(stmt, 1, stripId.module);
     sqlite3_bind_int(stmt, 2, stripId.row);
@@ -81,6 +107,46 @@ double INOCalibrationManager::getStripTimeDelay(const StripId& stripId) const {
   return value;
 }
 
+// called with dbMutex locked, or before other threads can see the instance
+void INOCalibrationManager::loadStripTimeDelays() const {
+  std::fill(stripTimeDelays.begin(), stripTimeDelays.end(), defaultStripTimeDelay);
+  if (!db) {
+    isStripTimeDelayCacheValid.store(true, std::memory_order_release);
+    return;
+  }
+  sqlite3_busy_timeout(db, 5000);
+
+  const char* sql = "SELECT Module, Row, Column, Layer, Side, Strip, Value FROM StripTimeDelay;";
+  sqlite3_stmt* stmt;
+  if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) == SQLITE_OK) {
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+      StripId stripId = {sqlite3_column_int(stmt, 0),
+                         sqlite3_column_int(stmt, 1),
+                         sqlite3_column_int(stmt, 2),
+                         sqlite3_column_int(stmt, 3),
+                         sqlite3_column_int(stmt, 4),
+                         sqlite3_column_int(stmt, 5)};
+      int index = getStripIndex(stripId);
+      if (index >= 0)
+        stripTimeDelays[index] = sqlite3_column_double(stmt, 6);
+    }
+    sqlite3_finalize(stmt);
+  } else {
+    std::cerr << "SQL error in loadStripTimeDelays: " << sqlite3_errmsg(db) << std::endl;
+  }
+  // publish the filled table to the readers
+  isStripTimeDelayCacheValid.store(true, std::memory_order_release);
+}
+
+void INOCalibrationManager::reloadStripTimeDelays() {
+  std::lock_guard<std::mutex> lock(dbMutex);
+  loadStripTimeDelays();
+}
+
+void INOCalibrationManager::invalidateStripTimeDelays() {
+  isStripTimeDelayCacheValid.store(false, std::memory_order_release);
+}
+
 // void INOCalibrationManager::setStripPositionCorrection(const StripId& stripId, int position, double start, double end, double value) {
 //   std::string sql = "INSERT INTO StripPositionCorrection (Start, End, Module, Row, Column, Layer, Side, Strip, Position, Value) "
 //                     "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?) "
@@ -109,6 +175,7 @@ void INOCalibrationManager::getLayerPosition(const LayerId& layerId, const int&
 					     TVector3& position, TVector3& orientation) const {
   const char* sql = "SELECT position_x, position_y, position_z, orientation_x, orientation_y, orientation_z "
     "FROM Position WHERE Module =? AND Row =? AND Column =? AND Layer = ? AND detector_type_x = ? AND detector_type_y = ?;";
+  std::lock_guard<std::mutex> lock(dbMutex);
   sqlite3_stmt* stmt;
   // Prepare the statement
   if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) == SQLITE_OK) {
@@ -0,0 +1,86 @@
+
+#include "INOClustering.h"
+#include "INOInstrumentation.h"
+
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+namespace INO {
+
+  void findClusters(const INOEvent& inoEvent, std::vector<StripCluster>& clusters) {
+    INO_SCOPED_TIMER("cluster");
+    clusters.clear();
+    for (int module = 0; module < nModules; module++)
+      for (int row = 0; row < nRows; row++)
+        for (int column = 0; column < nColumns; column++)
+          for (int layer = 0; layer < nLayers; layer++)
+            for (int side = 0; side < nSides; side++) {
+              SideId sideId = {module, row, column, layer, side};
+              forEachBitRun(inoEvent.getStripMask(sideId), [&](int first, int size) {
+                double time = std::numeric_limits<double>::quiet_NaN();
+                for (int strip = first; strip < first + size; strip++)
+                  for (double stripTime : inoEvent.getCalibratedLeadingTimes({module, row, column, layer, side, strip}))
+                    if (!(stripTime >= time)) time = stripTime;
+                clusters.push_back({sideId, first, size, time});
+              });
+            }
+  }
+
+
+  void collectClusterTimes(const INOEvent& inoEvent, const StripCluster& cluster, std::vector<double>& times) {
+    times.clear();
+    const SideId& sideId = cluster.sideId;
+    for (int strip = cluster.firstStrip; strip < cluster.firstStrip + cluster.size; strip++)
+      for (double stripTime : inoEvent.getCalibratedLeadingTimes({sideId.module, sideId.row, sideId.column,
+                                                                  sideId.layer, sideId.side, strip}))
+        times.push_back(stripTime);
+    std::sort(times.begin(), times.end());
+    times.erase(std::unique(times.begin(), times.end()), times.end());
+  }
+
+
+  bool formClusterPixels(const INOEvent& inoEvent, const std::vector<StripCluster>& clusters,
+                         std::vector<PixelId>& pixels) {
+    INO_SCOPED_TIMER("track/pixels");
+    // clusters with a strip in time group 0, by layer side
+    const int maxSideClusters = nStrips / 2;
+    int sideClusters[nSideIndices][maxSideClusters];
+    int nSideClusters[nSideIndices] = {0};
+    for (int ij = 0; ij < int(clusters.size()); ij++) {
+      const StripCluster& cluster = clusters[ij];
+      if (std::isnan(cluster.time)) continue;
+      bool isGroup0 = false;
+      for (int strip = cluster.firstStrip; strip < cluster.firstStrip + cluster.size && !isGroup0; strip++) {
+        const SideId& sideId = cluster.sideId;
+        const auto& groupIds = inoEvent.getTimeGroupId({sideId.module, sideId.row, sideId.column,
+                                                        sideId.layer, sideId.side, strip});
+        isGroup0 = std::find(groupIds.begin(), groupIds.end(), 0) != groupIds.end();
+      }
+      int sideIndex = getSideIndex(cluster.sideId);
+      if (!isGroup0 || sideIndex < 0) continue;
+      sideClusters[sideIndex][nSideClusters[sideIndex]++] = ij;
+    }
+
+    int nSidesWithClusters = 0;
+    for (int sideIndex = 0; sideIndex < nSideIndices; sideIndex++)
+      nSidesWithClusters += nSideClusters[sideIndex] > 0;
+    if (nSidesWithClusters < 10) return false;
+
+    for (int layerIndex = 0; layerIndex < nLayerIndices; layerIndex++) {
+      int nX = nSideClusters[layerIndex * nSides], nY = nSideClusters[layerIndex * nSides + 1];
+      // as formPixels, a crowded side still pairs with the clusters of the other side
+      if (nX > 5 && nY > 5) continue;
+      for (int ij = 0; ij < nX; ij++)
+        for (int jk = 0; jk < nY; jk++) {
+          const StripCluster& xCluster = clusters[sideClusters[layerIndex * nSides][ij]];
+          const StripCluster& yCluster = clusters[sideClusters[layerIndex * nSides + 1][jk]];
+          const SideId& sideId = xCluster.sideId;
+          pixels.push_back({sideId.module, sideId.row, sideId.column, sideId.layer,
+                            {xCluster.getCentralStrip(), yCluster.getCentralStrip()}});
+        }
+    }
+    return true;
+  }
+
+} // namespace INO
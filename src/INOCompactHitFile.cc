@@ -0,0 +1,222 @@
+
+#include "INOCompactHitFile.h"
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace INO {
+
+  namespace {
+    /** Size of a file with these numbers of events, masks and TDC hits */
+    uint64_t getCompactHitFileSize(uint64_t nEvents, uint64_t nMasks, uint64_t nTDCHits) {
+      return sizeof(CompactHitFileHeader) +
+        nEvents * (sizeof(uint64_t) + sizeof(double)) + 2 * (nEvents + 1) * sizeof(uint64_t) +
+        nMasks * (sizeof(uint64_t) + sizeof(uint8_t)) +
+        nTDCHits * (sizeof(int32_t) + 2 * sizeof(uint16_t));
+    }
+
+    template <class T>
+    void writeColumn(std::ofstream& file, const std::vector<T>& column) {
+      file.write(reinterpret_cast<const char*>(column.data()), column.size() * sizeof(T));
+    }
+  }
+
+
+  INOCompactHitWriter::INOCompactHitWriter(const std::string& fileName) :
+    m_fileName(fileName), m_isClosed(false) {
+    m_maskBegin.push_back(0);
+    m_tdcBegin.push_back(0);
+  }
+
+  INOCompactHitWriter::~INOCompactHitWriter() {
+    if (!m_isClosed) close();
+  }
+
+  void INOCompactHitWriter::addEvent(const RawEvent& event) {
+    m_nevt.push_back(event.nevt);
+    m_evetime.push_back(event.evetime[0]);
+    for (int nj = 0; nj < nRawSides; nj++)
+      for (int ij = 0; ij < nRawLayers; ij++) {
+        if (event.xydata[nj][ij]) {
+          m_mask.push_back(event.xydata[nj][ij]);
+          m_maskSide.push_back(nj * nRawLayers + ij);
+        }
+        for (int jk = 0; jk < nRawTDCs; jk++)
+          for (int tc = 0; tc < event.xythit[nj][ij][jk]; tc++) {
+            m_leading.push_back(event.xytime[nj][ij][jk][tc]);
+            m_width.push_back(event.plWidth[nj][ij][jk][tc]);
+            m_channel.push_back((nj * nRawLayers + ij) * nRawTDCs + jk);
+          }
+      }
+    m_maskBegin.push_back(m_mask.size());
+    m_tdcBegin.push_back(m_leading.size());
+  }
+
+  bool INOCompactHitWriter::close() {
+    m_isClosed = true;
+    std::ofstream file(m_fileName, std::ios::binary | std::ios::trunc);
+    if (!file) {
+      std::cerr << "Error: cannot write " << m_fileName << "\n";
+      return false;
+    }
+    CompactHitFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, compactHitFileMagic, sizeof(header.magic));
+    header.version = 1;
+    header.nEvents = m_nevt.size();
+    header.nMasks = m_mask.size();
+    header.nTDCHits = m_leading.size();
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writeColumn(file, m_nevt);
+    writeColumn(file, m_evetime);
+    writeColumn(file, m_maskBegin);
+    writeColumn(file, m_tdcBegin);
+    writeColumn(file, m_mask);
+    writeColumn(file, m_leading);
+    writeColumn(file, m_width);
+    writeColumn(file, m_channel);
+    writeColumn(file, m_maskSide);
+    file.close();
+    if (!file) {
+      std::cerr << "Error: writing " << m_fileName << " failed\n";
+      return false;
+    }
+    return true;
+  }
+
+
+  INOCompactEventSource::INOCompactEventSource(const std::string& fileName) :
+    m_data(nullptr), m_size(0), m_activeLayers(0xFFF), m_entry(-1), m_header(nullptr) {
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+      std::cerr << "Error: cannot open " << fileName << "\n";
+      return;
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || size_t(status.st_size) < sizeof(CompactHitFileHeader)) {
+      std::cerr << "Error: " << fileName << " is not a compact hit file\n";
+      ::close(fd);
+      return;
+    }
+    m_size = status.st_size;
+    void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+      std::cerr << "Error: cannot map " << fileName << "\n";
+      return;
+    }
+
+    const CompactHitFileHeader* header = static_cast<const CompactHitFileHeader*>(data);
+    if (std::memcmp(header->magic, compactHitFileMagic, sizeof(header->magic)) != 0 ||
+        header->version != 1 ||
+        header->nEvents > m_size || header->nMasks > m_size || header->nTDCHits > m_size ||
+        getCompactHitFileSize(header->nEvents, header->nMasks, header->nTDCHits) != m_size) {
+      std::cerr << "Error: " << fileName << " is not a valid compact hit file\n";
+      munmap(data, m_size);
+      return;
+    }
+    madvise(data, m_size, MADV_SEQUENTIAL);
+
+    m_data = static_cast<const char*>(data);
+    m_header = header;
+    const char* column = m_data + sizeof(CompactHitFileHeader);
+    auto nextColumn = [&column](uint64_t size) {
+      const char* begin = column;
+      column += size;
+      return begin;
+    };
+    m_nevt      = reinterpret_cast<const uint64_t*>(nextColumn(header->nEvents * sizeof(uint64_t)));
+    m_evetime   = reinterpret_cast<const double*>(nextColumn(header->nEvents * sizeof(double)));
+    m_maskBegin = reinterpret_cast<const uint64_t*>(nextColumn((header->nEvents + 1) * sizeof(uint64_t)));
+    m_tdcBegin  = reinterpret_cast<const uint64_t*>(nextColumn((header->nEvents + 1) * sizeof(uint64_t)));
+    m_mask      = reinterpret_cast<const uint64_t*>(nextColumn(header->nMasks * sizeof(uint64_t)));
+    m_leading   = reinterpret_cast<const int32_t*>(nextColumn(header->nTDCHits * sizeof(int32_t)));
+    m_width     = reinterpret_cast<const uint16_t*>(nextColumn(header->nTDCHits * sizeof(uint16_t)));
+    m_channel   = reinterpret_cast<const uint16_t*>(nextColumn(header->nTDCHits * sizeof(uint16_t)));
+    m_maskSide  = reinterpret_cast<const uint8_t*>(nextColumn(header->nMasks * sizeof(uint8_t)));
+
+    if (!hasValidColumns()) {
+      std::cerr << "Error: " << fileName << " is not a valid compact hit file\n";
+      munmap(data, m_size);
+      m_data = nullptr;
+      m_header = nullptr;
+    }
+  }
+
+  bool INOCompactEventSource::hasValidColumns() const {
+    if (m_maskBegin[0] != 0 || m_maskBegin[m_header->nEvents] != m_header->nMasks ||
+        m_tdcBegin[0] != 0 || m_tdcBegin[m_header->nEvents] != m_header->nTDCHits)
+      return false;
+    for (uint64_t entry = 0; entry < m_header->nEvents; entry++)
+      if (m_maskBegin[entry] > m_maskBegin[entry + 1] || m_tdcBegin[entry] > m_tdcBegin[entry + 1])
+        return false;
+    for (uint64_t im = 0; im < m_header->nMasks; im++)
+      if (m_maskSide[im] >= nRawSides * nRawLayers) return false;
+    // the hits of a channel follow each other, at most as many as xythit counts
+    for (uint64_t entry = 0; entry < m_header->nEvents; entry++) {
+      int channel = -1, nHits = 0;
+      for (uint64_t it = m_tdcBegin[entry]; it < m_tdcBegin[entry + 1]; it++) {
+        if (m_channel[it] >= nRawSides * nRawLayers * nRawTDCs || m_channel[it] < channel) return false;
+        nHits = m_channel[it] == channel ? nHits + 1 : 1;
+        channel = m_channel[it];
+        if (nHits > UINT8_MAX) return false;
+      }
+    }
+    return true;
+  }
+
+  INOCompactEventSource::~INOCompactEventSource() {
+    if (m_data) munmap(const_cast<char*>(m_data), m_size);
+  }
+
+  bool INOCompactEventSource::readHeader(int64_t entry) {
+    if (!m_data || entry < 0 || entry >= getEntries()) return false;
+    m_entry = entry;
+
+    RawEvent& event = *m_event;
+    event.nevt = m_nevt[entry];
+    std::memset(event.evetime, 0, sizeof(event.evetime));
+    event.evetime[0] = m_evetime[entry];
+
+    // strip masks of all layers, like the xydata branch
+    std::memset(event.xydata, 0, sizeof(event.xydata));
+    for (uint64_t im = m_maskBegin[entry]; im < m_maskBegin[entry + 1]; im++)
+      event.xydata[m_maskSide[im] / nRawLayers][m_maskSide[im] % nRawLayers] = m_mask[im];
+
+    // hit counts of the active layers
+    std::memset(event.xythit, 0, sizeof(event.xythit));
+    uint8_t* xythit = &event.xythit[0][0][0];
+    for (uint64_t it = m_tdcBegin[entry]; it < m_tdcBegin[entry + 1]; it++) {
+      int channel = m_channel[it];
+      if (!((m_activeLayers >> (channel / nRawTDCs % nRawLayers)) & 0x01)) continue;
+      xythit[channel]++;
+    }
+    return true;
+  }
+
+  void INOCompactEventSource::readTDCs() {
+    if (m_entry < 0) return;
+
+    RawEvent& event = *m_event;
+    int32_t (*xytime)[nRawTDCHits] = &event.xytime[0][0][0];
+    uint16_t (*plWidth)[nRawTDCHits] = &event.plWidth[0][0][0];
+    int channel = -1, tc = 0;
+    for (uint64_t it = m_tdcBegin[m_entry]; it < m_tdcBegin[m_entry + 1]; it++) {
+      if (m_channel[it] != channel) {
+        channel = m_channel[it];
+        tc = 0;
+      }
+      if (!((m_activeLayers >> (channel / nRawTDCs % nRawLayers)) & 0x01)) continue;
+      xytime[channel][tc] = m_leading[it];
+      plWidth[channel][tc] = m_width[it];
+      tc++;
+    }
+  }
+
+} // namespace INO
@@ -0,0 +1,152 @@
+
+#include "INOEfficiencyAccumulator.h"
+
+#include <iostream>
+#include <string>
+
+#include "TDirectory.h"
+#include "TH1D.h"
+#include "TH2D.h"
+#include "TEfficiency.h"
+
+namespace INO {
+
+  namespace {
+
+    const EfficiencyCounts noCounts;
+
+    /** Passed and total histograms of counts, one bin per index */
+    void writeCounts(TDirectory* directory, const std::string& name,
+                     const std::vector<EfficiencyCounts>& counts) {
+      TH1D passed((name + "Passed").c_str(), (name + "Passed").c_str(), counts.size(), -0.5, counts.size() - 0.5);
+      TH1D total((name + "Total").c_str(), (name + "Total").c_str(), counts.size(), -0.5, counts.size() - 0.5);
+      passed.SetDirectory(0);
+      total.SetDirectory(0);
+      for (size_t ij = 0; ij < counts.size(); ij++) {
+        passed.SetBinContent(ij + 1, counts[ij].passed);
+        total.SetBinContent(ij + 1, counts[ij].total);
+      }
+      directory->cd();
+      passed.Write();
+      total.Write();
+    }
+
+    bool readCounts(TDirectory* directory, const std::string& name,
+                    std::vector<EfficiencyCounts>& counts) {
+      TH1* passed = nullptr;
+      TH1* total = nullptr;
+      directory->GetObject((name + "Passed").c_str(), passed);
+      directory->GetObject((name + "Total").c_str(), total);
+      if (!passed || !total || passed->GetNbinsX() != int(counts.size()) || total->GetNbinsX() != int(counts.size())) {
+        std::cerr << "Error: no efficiency counts " << name << " in " << directory->GetName() << std::endl;
+        return false;
+      }
+      for (size_t ij = 0; ij < counts.size(); ij++) {
+        counts[ij].passed += passed->GetBinContent(ij + 1);
+        counts[ij].total += total->GetBinContent(ij + 1);
+      }
+      return true;
+    }
+
+  } // namespace
+
+
+  void EfficiencyCounts::getInterval(double level, double& low, double& high) const {
+    low = TEfficiency::ClopperPearson(total, passed, level, false);
+    high = TEfficiency::ClopperPearson(total, passed, level, true);
+  }
+
+
+  INOEfficiencyAccumulator::INOEfficiencyAccumulator() :
+    m_layers(nLayerIndices), m_sides(nSideIndices), m_cells(nPixelIndices) {}
+
+  void INOEfficiencyAccumulator::add(const EfficiencyProbe& probe) {
+    const PixelId& cell = probe.cell;
+    int layerIndex = getLayerIndex(cell.module, cell.row, cell.column, cell.layer);
+    int pixelIndex = getPixelIndex(cell);
+    if (layerIndex < 0 || pixelIndex < 0) return;
+    bool isPassed = true;
+    for (int nj = 0; nj < nSides; nj++) {
+      m_sides[getSideIndex({cell.module, cell.row, cell.column, cell.layer, nj})].add(probe.passed[nj]);
+      isPassed = isPassed && probe.passed[nj];
+    }
+    m_layers[layerIndex].add(isPassed);
+    m_cells[pixelIndex].add(isPassed);
+  }
+
+  void INOEfficiencyAccumulator::merge(const INOEfficiencyAccumulator& other) {
+    for (int ij = 0; ij < nLayerIndices; ij++) m_layers[ij].add(other.m_layers[ij]);
+    for (int ij = 0; ij < nSideIndices; ij++) m_sides[ij].add(other.m_sides[ij]);
+    for (int ij = 0; ij < nPixelIndices; ij++) m_cells[ij].add(other.m_cells[ij]);
+  }
+
+  const EfficiencyCounts& INOEfficiencyAccumulator::getLayerCounts(const LayerId& layerId) const {
+    int index = getLayerIndex(layerId.module, layerId.row, layerId.column, layerId.layer);
+    return index < 0 ? noCounts : m_layers[index];
+  }
+
+  const EfficiencyCounts& INOEfficiencyAccumulator::getSideCounts(const SideId& sideId) const {
+    int index = getSideIndex(sideId);
+    return index < 0 ? noCounts : m_sides[index];
+  }
+
+  const EfficiencyCounts& INOEfficiencyAccumulator::getCellCounts(const PixelId& pixelId) const {
+    int index = getPixelIndex(pixelId);
+    return index < 0 ? noCounts : m_cells[index];
+  }
+
+  uint64_t INOEfficiencyAccumulator::getNProbes() const {
+    uint64_t nProbes = 0;
+    for (const auto& counts : m_layers) nProbes += counts.total;
+    return nProbes;
+  }
+
+  void INOEfficiencyAccumulator::write(TDirectory* directory) const {
+    writeCounts(directory, "layer", m_layers);
+    writeCounts(directory, "side", m_sides);
+    for (int layerIndex = 0; layerIndex < nLayerIndices; layerIndex++) {
+      std::string passedName = "cellPassed_" + std::to_string(layerIndex);
+      std::string totalName = "cellTotal_" + std::to_string(layerIndex);
+      TH2D passed(passedName.c_str(), passedName.c_str(), nStrips, -0.5, nStrips - 0.5, nStrips, -0.5, nStrips - 0.5);
+      TH2D total(totalName.c_str(), totalName.c_str(), nStrips, -0.5, nStrips - 0.5, nStrips, -0.5, nStrips - 0.5);
+      passed.SetDirectory(0);
+      total.SetDirectory(0);
+      for (int xStrip = 0; xStrip < nStrips; xStrip++)
+        for (int yStrip = 0; yStrip < nStrips; yStrip++) {
+          const EfficiencyCounts& counts = m_cells[(layerIndex * nStrips + xStrip) * nStrips + yStrip];
+          passed.SetBinContent(xStrip + 1, yStrip + 1, counts.passed);
+          total.SetBinContent(xStrip + 1, yStrip + 1, counts.total);
+        }
+      directory->cd();
+      passed.Write();
+      total.Write();
+    }
+  }
+
+  bool INOEfficiencyAccumulator::read(TDirectory* directory) {
+    // nothing is added unless all histograms are there
+    INOEfficiencyAccumulator loaded;
+    if (!readCounts(directory, "layer", loaded.m_layers) || !readCounts(directory, "side", loaded.m_sides))
+      return false;
+    for (int layerIndex = 0; layerIndex < nLayerIndices; layerIndex++) {
+      TH1* passed = nullptr;
+      TH1* total = nullptr;
+      directory->GetObject(("cellPassed_" + std::to_string(layerIndex)).c_str(), passed);
+      directory->GetObject(("cellTotal_" + std::to_string(layerIndex)).c_str(), total);
+      if (!passed || !total) {
+        std::cerr << "Error: no efficiency cell counts of layer " << layerIndex
+                  << " in " << directory->GetName() << std::endl;
+        return false;
+      }
+      for (int xStrip = 0; xStrip < nStrips; xStrip++)
+        for (int yStrip = 0; yStrip < nStrips; yStrip++) {
+          EfficiencyCounts& counts = loaded.m_cells[(layerIndex * nStrips + xStrip) * nStrips + yStrip];
+          counts.passed += passed->GetBinContent(xStrip + 1, yStrip + 1);
+          counts.total += total->GetBinContent(xStrip + 1, yStrip + 1);
+        }
+    }
+    merge(loaded);
+    return true;
+  }
+
+} // namespace INO
@@ -1,93 +1,179 @@
 #include "INOEvent.h"
+#include "INOInstrumentation.h"
+
+#include <stdexcept>
 
 namespace INO {
 
+  static const std::vector<double> emptyTimes;
+
   INOEvent::INOEvent() 
-    : eventTime(std::numeric_limits<double>::quiet_NaN()),
+    : nUsedHitSlots(0),
+      nHits(0),
+      eventTime(std::numeric_limits<double>::quiet_NaN()),
       lowestCalibratedLeadingTime(std::numeric_limits<double>::quiet_NaN()),
       highestCalibratedLeadingTime(std::numeric_limits<double>::quiet_NaN()) {
     rawHits.clear();
-    rawTDCs[0].clear();
-    rawTDCs[1].clear();
+    hitSlots.fill(-1);
+    hitMask.fill(0);
+  }
+
+  void INOEvent::reset() {
+    for (int slot = 0; slot < nUsedHitSlots; slot++) {
+      int index = getStripIndex(rawHits[slot].stripId);
+      if (index >= 0) hitSlots[index] = -1;
+    }
+    nUsedHitSlots = 0;
+    nHits = 0;
+    hitMask.fill(0);
+    for (auto& tdcs : rawTDCs)
+      for (auto& times : tdcs)
+        times.clear();
+    eventTime = std::numeric_limits<double>::quiet_NaN();
+    lowestCalibratedLeadingTime = std::numeric_limits<double>::quiet_NaN();
+    highestCalibratedLeadingTime = std::numeric_limits<double>::quiet_NaN();
+  }
+
+  const Hit* INOEvent::findHit(const StripId& stripId) const {
+    int index = getStripIndex(stripId);
+    if (index < 0 || hitSlots[index] < 0) return nullptr;
+    return &rawHits[hitSlots[index]];
+  }
+
+  Hit* INOEvent::findHit(const StripId& stripId) {
+    int index = getStripIndex(stripId);
+    if (index < 0 || hitSlots[index] < 0) return nullptr;
+    return &rawHits[hitSlots[index]];
+  }
+
+  Hit& INOEvent::findOrCreateHit(const StripId& stripId) {
+    int index = getStripIndex(stripId);
+    if (index < 0)
+      throw std::out_of_range("INOEvent: strip outside the detector");
+    if (hitSlots[index] < 0) {
+      if (nUsedHitSlots == int(rawHits.size()))
+        rawHits.emplace_back();
+      hitSlots[index] = nUsedHitSlots++;
+      hitMask[index / nStrips] |= uint64_t(1) << (index % nStrips);
+      nHits++;
+      Hit& hit = rawHits[hitSlots[index]];
+      // a reused slot keeps the capacity of its vectors
+      for (int timeType = 0; timeType < 2; timeType++) {
+        hit.rawTimes[timeType].clear();
+        hit.calibratedTimes[timeType].clear();
+        hit.trackedCalibratedTime[timeType] = std::numeric_limits<double>::quiet_NaN();
+      }
+      hit.rawPosition = std::numeric_limits<double>::quiet_NaN();
+      hit.alignedPosition = std::numeric_limits<double>::quiet_NaN();
+      hit.m_timeGroupId.clear();
+      hit.m_timeGroupInfo.clear();
+      hit.stripId = stripId;
+    }
+    return rawHits[hitSlots[index]];
   }
 
   void INOEvent::addHit(const StripId& stripId) {
+    INO_SCOPED_TIMER("addHit");
+    if (getStripIndex(stripId) < 0) {
+      std::cerr << "Error: strip l" << stripId.layer << " s" << stripId.strip
+                << " is outside the detector, hit ignored\n";
+      return;
+    }
     INOCalibrationManager& inoCalibrationManager = INOCalibrationManager::getInstance();
-    Hit rawHit;
-    rawHit.stripId = stripId;
+    if (hasHit(stripId)) removeHit(stripId);
+    Hit& rawHit = findOrCreateHit(stripId);
     rawHit.rawPosition = stripId.strip + 0.5;
+    int tdcIndex = getTDCIndex({stripId.module, stripId.row, stripId.column,
+                                stripId.layer, stripId.side, stripId.strip % nTDCs});
+    double stripTimeDelay = inoCalibrationManager.getStripTimeDelay(stripId);
     for (int timeType = 0; timeType < 2; timeType++) {
-      TDCId tdcId = {stripId.module, stripId.row, stripId.column,
-                     stripId.layer, stripId.side, stripId.strip % 8};
-      if (rawTDCs[timeType].count(tdcId))
-        rawHit.rawTimes[timeType] = rawTDCs[timeType][tdcId];
+      const auto& tdcTimes = rawTDCs[timeType][tdcIndex];
+      rawHit.rawTimes[timeType].assign(tdcTimes.begin(), tdcTimes.end());
       for (auto rawTime : rawHit.rawTimes[timeType])
-        rawHit.calibratedTimes[timeType].push_back(rawTime - inoCalibrationManager.getStripTimeDelay(stripId));
-      // std::cout << inoCalibrationManager.getStripTimeDelay(stripId) << std::endl;
+        rawHit.calibratedTimes[timeType].push_back(rawTime - stripTimeDelay);
     }
-    rawHits[stripId] = rawHit; 
   }
 
   bool INOEvent::hasHit(const StripId& stripId) const {
-    return rawHits.count(stripId);
+    return findHit(stripId) != nullptr;
+  }
+
+  uint64_t INOEvent::getStripMask(const SideId& sideId) const {
+    int index = getSideIndex(sideId);
+    return index < 0 ? 0 : hitMask[index];
   }
 
   void INOEvent::removeHit(const StripId& stripId) { 
-    rawHits.erase(stripId); 
+    int index = getStripIndex(stripId);
+    if (index < 0 || hitSlots[index] < 0) return;
+    // the slot in rawHits is left unused until the event is reset
+    hitSlots[index] = -1;
+    hitMask[index / nStrips] &= ~(uint64_t(1) << (index % nStrips));
+    nHits--;
   }
 
   std::vector<const Hit*> INOEvent::getHits() const {
     std::vector<const Hit*> hits;
-    for (const auto& entry : rawHits) {
-      hits.push_back(&entry.second);
-    }
+    hits.reserve(nHits);
+    for (const auto& hit : getHitRange())
+      hits.push_back(&hit);
     return hits;
   }
 
+  HitRange INOEvent::getHitRange() const {
+    return HitRange(rawHits.data(), hitSlots.data(), hitMask.data());
+  }
+
   double INOEvent::getRawLeadingTime(const StripId& stripId) const {
-    auto it = rawHits.find(stripId);
-    if (it != rawHits.end() && !it->second.rawTimes[0].empty())
-      return it->second.rawTimes[0][0];
+    const Hit* hit = findHit(stripId);
+    if (hit && !hit->rawTimes[0].empty())
+      return hit->rawTimes[0][0];
     return std::numeric_limits<double>::quiet_NaN();
   }
 
-  std::vector<double> INOEvent::getRawLeadingTimes(const StripId& stripId) const {
-    auto it = rawHits.find(stripId); 
-    if (it != rawHits.end())
-      return it->second.rawTimes[0];
-    return {};
+  const std::vector<double>& INOEvent::getRawLeadingTimes(const StripId& stripId) const {
+    const Hit* hit = findHit(stripId);
+    if (hit)
+      return hit->rawTimes[0];
+    return emptyTimes;
   }
 
-  std::vector<double> INOEvent::getCalibratedLeadingTimes(const StripId& stripId) const {
-    auto it = rawHits.find(stripId); 
-    if (it != rawHits.end())
-      return it->second.calibratedTimes[0];
-    return {};
+  const std::vector<double>& INOEvent::getCalibratedLeadingTimes(const StripId& stripId) const {
+    const Hit* hit = findHit(stripId);
+    if (hit)
+      return hit->calibratedTimes[0];
+    return emptyTimes;
   }
 
   double INOEvent::getTrackedLeadingTime(const StripId& stripId) const {
-    auto it = rawHits.find(stripId);
-    if (it != rawHits.end())
-      return it->second.trackedCalibratedTime[0];
+    const Hit* hit = findHit(stripId);
+    if (hit)
+      return hit->trackedCalibratedTime[0];
     return std::numeric_limits<double>::quiet_NaN();
   }
 
   double INOEvent::getAlignedPosition(const StripId& stripId) const {
-    auto it = rawHits.find(stripId);
-    if (it != rawHits.end())
-      return it->second.alignedPosition;
+    const Hit* hit = findHit(stripId);
+    if (hit)
+      return hit->alignedPosition;
     return std::numeric_limits<double>::quiet_NaN();
   }
 
   void INOEvent::addTDC(const TDCId& tdcId, double time, bool isTrailing) {
+    int tdcIndex = getTDCIndex(tdcId);
+    if (tdcIndex < 0) {
+      std::cerr << "Error: TDC l" << tdcId.layer << " t" << tdcId.tdc
+                << " is outside the detector, time ignored\n";
+      return;
+    }
     int index = isTrailing ? 1 : 0;
-    rawTDCs[index][tdcId].push_back(time);
+    rawTDCs[index][tdcIndex].push_back(time);
   }
 
   std::vector<double> INOEvent::getLeadingTDCs() const {
     std::vector<double> leadingTDCs;
     for (const auto& entry : rawTDCs[0]) {
-      leadingTDCs.insert(leadingTDCs.end(), entry.second.begin(), entry.second.end());
+      leadingTDCs.insert(leadingTDCs.end(), entry.begin(), entry.end());
     }
     return leadingTDCs;
   }
@@ -103,9 +189,9 @@ namespace INO {
   void INOEvent::updateCalibratedLeadingTimeBounds() {
     lowestCalibratedLeadingTime = std::numeric_limits<double>::infinity();
     highestCalibratedLeadingTime = -std::numeric_limits<double>::infinity();
-    for (const auto& entry : rawHits) {
-      if (entry.second.calibratedTimes[0].empty()) continue;
-      for (double calibratedTime : entry.second.calibratedTimes[0]) {
+    for (const auto& hit : getHitRange()) {
+      if (hit.calibratedTimes[0].empty()) continue;
+      for (double calibratedTime : hit.calibratedTimes[0]) {
         lowestCalibratedLeadingTime = std::min(lowestCalibratedLeadingTime, calibratedTime);
         highestCalibratedLeadingTime = std::max(highestCalibratedLeadingTime, calibratedTime);
       }
@@ -128,24 +214,35 @@ namespace INO {
     return highestCalibratedLeadingTime;
   }
 
-  std::vector<int> INOEvent::getTimeGroupId(const StripId& stripId) const {
-    return rawHits.at(stripId).m_timeGroupId;
+  const std::vector<int>& INOEvent::getTimeGroupId(const StripId& stripId) const {
+    const Hit* hit = findHit(stripId);
+    if (!hit) throw std::out_of_range("INOEvent::getTimeGroupId: no hit on strip");
+    return hit->m_timeGroupId;
   }
 
-  std::vector<std::tuple<float, float, float>> INOEvent::getTimeGroupInfo(const StripId& stripId) const {
-    return rawHits.at(stripId).m_timeGroupInfo;
+  const std::vector<std::tuple<float, float, float>>& INOEvent::getTimeGroupInfo(const StripId& stripId) const {
+    const Hit* hit = findHit(stripId);
+    if (!hit) throw std::out_of_range("INOEvent::getTimeGroupInfo: no hit on strip");
+    return hit->m_timeGroupInfo;
   }
 
   std::vector<int>& INOEvent::setTimeGroupId(const StripId& stripId) {
-    return rawHits[stripId].m_timeGroupId;
+    return findOrCreateHit(stripId).m_timeGroupId;
   }
 
   std::vector<std::tuple<float, float, float>>& INOEvent::setTimeGroupInfo(const StripId& stripId) {
-    return rawHits[stripId].m_timeGroupInfo;
+    return findOrCreateHit(stripId).m_timeGroupInfo;
+  }
+
+  void INOEvent::clearTimeGroups() {
+    for (int slot = 0; slot < nUsedHitSlots; slot++) {
+      rawHits[slot].m_timeGroupId.clear();
+      rawHits[slot].m_timeGroupInfo.clear();
+    }
   }
 
   int INOEvent::getEntries() const {
-    return rawHits.size();
+    return nHits;
   }
 
 } // namespace INO
@@ -0,0 +1,105 @@
+
+#include "INOEventGenerator.h"
+#include "INOCalibrationManager.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+namespace INO {
+
+  namespace {
+    const double speedOfLight = 0.29979; // m/ns
+  }
+
+  INOEventGenerator::INOEventGenerator(const Parameters& pars) :
+    m_pars(pars), m_random(pars.seed), m_nevt(0), m_eventTime(pars.startTime),
+    m_stripTimeDelays(nStripIndices) {
+    m_pars.layerEfficiency.resize(nLayers, 1.);
+    const INOCalibrationManager& calibration = INOCalibrationManager::getInstance();
+    for (int ij = 0; ij < nLayers; ij++)
+      for (int nj = 0; nj < nSides; nj++)
+        for (int kl = 0; kl < nStrips; kl++) {
+          StripId stripId{0, 0, 0, ij, nj, kl};
+          m_stripTimeDelays[getStripIndex(stripId)] = calibration.getStripTimeDelay(stripId);
+        }
+  }
+
+  bool INOEventGenerator::fireStrip(RawEvent& event, int layer, int side, int strip, double time) {
+    int index = getStripIndex({0, 0, 0, layer, side, strip});
+    if (index < 0) return false;
+    event.xydata[side][layer] |= uint64_t(1) << strip;
+
+    int tdc = strip % nTDCs;
+    int nHits = event.xythit[side][layer][tdc];
+    // xythit is a UChar_t, later hits of a full channel are lost as in the hardware
+    if (nHits >= std::min(nRawTDCHits, 255)) return true;
+    double rawTime = time + m_stripTimeDelays[index] + m_random.Gaus(0., m_pars.timeResolution);
+    double width = std::max(m_pars.tdcLeast, m_random.Gaus(m_pars.pulseWidth[0], m_pars.pulseWidth[1]));
+    event.xytime[side][layer][tdc][nHits] = std::lround(rawTime / m_pars.tdcLeast);
+    event.plWidth[side][layer][tdc][nHits] = std::min<long>(65535, std::lround(width / m_pars.tdcLeast));
+    event.xythit[side][layer][tdc] = nHits + 1;
+    return true;
+  }
+
+  void INOEventGenerator::generate(RawEvent& event, Truth& truth) {
+    event.nevt = truth.nevt = m_nevt++;
+    m_eventTime += m_random.Exp(1. / m_pars.eventRate);
+    std::fill(std::begin(event.evetime), std::end(event.evetime), m_eventTime);
+    std::memset(event.xydata, 0, sizeof(event.xydata));
+    std::memset(event.xythit, 0, sizeof(event.xythit));
+
+    // cos^3 zenith distribution: cos(theta)^4 is uniform
+    double cosThetaMin4 = std::pow(std::cos(std::min(m_pars.maxZenith, M_PI / 2)), 4);
+    double cosTheta = std::pow(m_random.Uniform(cosThetaMin4, 1.), 0.25);
+    double tanTheta = std::sqrt(std::max(0., 1. - cosTheta * cosTheta)) / cosTheta;
+    double phi = m_random.Uniform(0., 2. * M_PI);
+    double layerWidth = nStrips * m_pars.stripWidth;
+
+    truth.x0 = m_random.Uniform(0., layerWidth);
+    truth.y0 = m_random.Uniform(0., layerWidth);
+    truth.slopeX = tanTheta * std::cos(phi);
+    truth.slopeY = tanTheta * std::sin(phi);
+    truth.time = m_pars.trackTime;
+    truth.efficientLayers = 0;
+    truth.crossedLayers = 0;
+
+    for (int ij = 0; ij < nLayers; ij++) {
+      double dz = ij * m_pars.layerPitch;
+      double pos[nSides] = {truth.x0 + truth.slopeX * dz, truth.y0 + truth.slopeY * dz};
+      double time = truth.time + dz / (cosTheta * speedOfLight);
+      int strip[nSides];
+      for (int nj = 0; nj < nSides; nj++) {
+        strip[nj] = std::floor(pos[nj] / m_pars.stripWidth);
+        truth.strip[nj][ij] = -1;
+      }
+      bool isEfficient = m_random.Rndm() < m_pars.layerEfficiency[ij];
+      bool isCrossed = strip[0] >= 0 && strip[0] < nStrips && strip[1] >= 0 && strip[1] < nStrips;
+      if (isEfficient) truth.efficientLayers |= 1u << ij;
+      if (isCrossed) truth.crossedLayers |= 1u << ij;
+      if (!isEfficient || !isCrossed) continue;
+
+      for (int nj = 0; nj < nSides; nj++) {
+        truth.strip[nj][ij] = strip[nj];
+        // the signal runs along the strip, i.e. along the coordinate of the other side
+        double readoutTime = time + pos[!nj] / m_pars.propagationSpeed;
+        fireStrip(event, ij, nj, strip[nj], readoutTime);
+        for (int kl = strip[nj] - 1; m_random.Rndm() < m_pars.clusterProbability; kl--)
+          if (!fireStrip(event, ij, nj, kl, readoutTime)) break;
+        for (int kl = strip[nj] + 1; m_random.Rndm() < m_pars.clusterProbability; kl++)
+          if (!fireStrip(event, ij, nj, kl, readoutTime)) break;
+      }
+    }
+
+    truth.nNoiseStrips = 0;
+    for (int ij = 0; ij < nLayers; ij++)
+      for (int nj = 0; nj < nSides; nj++) {
+        int nNoise = m_random.Poisson(m_pars.noiseStrips);
+        for (int kl = 0; kl < nNoise; kl++)
+          fireStrip(event, ij, nj, m_random.Integer(nStrips),
+                    m_random.Uniform(m_pars.noiseTime[0], m_pars.noiseTime[1]));
+        truth.nNoiseStrips += nNoise;
+      }
+  }
+
+} // namespace INO
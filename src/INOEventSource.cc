@@ -0,0 +1,139 @@
+
+#include "INOEventSource.h"
+#include "INOCompactHitFile.h"
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+
+#include <TFile.h>
+#include <TTree.h>
+
+#include "SNM.h"
+
+namespace INO {
+
+  void copyRawEvent(const RawEvent& from, RawEvent& to) {
+    to.nevt = from.nevt;
+    std::memcpy(to.evetime, from.evetime, sizeof(to.evetime));
+    std::memcpy(to.xydata, from.xydata, sizeof(to.xydata));
+    std::memcpy(to.xythit, from.xythit, sizeof(to.xythit));
+    for (int nj = 0; nj < nRawSides; nj++)
+      for (int ij = 0; ij < nRawLayers; ij++)
+        for (int jk = 0; jk < nRawTDCs; jk++) {
+          int nTDCHits = from.xythit[nj][ij][jk];
+          if (!nTDCHits) continue;
+          std::memcpy(to.xytime[nj][ij][jk], from.xytime[nj][ij][jk], nTDCHits * sizeof(int32_t));
+          std::memcpy(to.plWidth[nj][ij][jk], from.plWidth[nj][ij][jk], nTDCHits * sizeof(uint16_t));
+        }
+  }
+
+
+  INOEventSource::INOEventSource() : m_event(new RawEvent) {
+    std::memset(m_event.get(), 0, sizeof(RawEvent));
+  }
+
+
+  INOSNMEventSource::INOSNMEventSource(const std::string& fileName) :
+    m_file(nullptr), m_tree(nullptr), m_snm(nullptr), m_cacheSize(0) {
+    m_file = TFile::Open(fileName.c_str(), "read");
+    if (!m_file || m_file->IsZombie()) {
+      std::cerr << "Error: cannot open " << fileName << "\n";
+      return;
+    }
+    m_tree = (TTree*)m_file->Get("SNM");
+    if (!m_tree) {
+      std::cerr << "Error: no SNM tree in " << fileName << "\n";
+      return;
+    }
+    m_snm = new SNM(m_tree);
+  }
+
+  INOSNMEventSource::~INOSNMEventSource() {
+    // the SNM destructor deletes the file of its tree
+    if (m_snm) delete m_snm;
+    else delete m_file;
+  }
+
+  int64_t INOSNMEventSource::getEntries() const {
+    return m_tree ? m_tree->GetEntries() : 0;
+  }
+
+  void INOSNMEventSource::setActiveLayers(unsigned layerMask) {
+    if (!m_snm) return;
+    m_snm->SetActiveLayers(layerMask);
+    std::memcpy(m_event->xythit, m_snm->xythit, sizeof(m_event->xythit));
+    updateCache();
+  }
+
+  void INOSNMEventSource::setCacheSize(int64_t bytes) {
+    m_cacheSize = bytes;
+    updateCache();
+  }
+
+  void INOSNMEventSource::updateCache() {
+    if (!m_snm || m_cacheSize <= 0) return;
+
+    const char *sideMark[2] = {"x","y"};
+
+    m_tree->SetCacheSize(m_cacheSize);
+    m_tree->DropBranchFromCache("*", kTRUE);
+    m_tree->AddBranchToCache("nevt");
+    m_tree->AddBranchToCache("evetime");
+    m_tree->AddBranchToCache("xydata");
+    for (int nj = 0; nj < nRawSides; nj++)
+      for (int ij = 0; ij < nRawLayers; ij++) {
+        if (!((m_snm->fActiveLayers >> ij) & 0x01)) continue;
+        for (int jk = 0; jk < nRawTDCs; jk++) {
+          m_tree->AddBranchToCache(TString::Format("xythit_%s_l%i_%i", sideMark[nj], ij, jk));
+          m_tree->AddBranchToCache(TString::Format("xytime_%s_l%i_%i", sideMark[nj], ij, jk));
+          m_tree->AddBranchToCache(TString::Format("plWidth_%s_l%i_%i", sideMark[nj], ij, jk));
+        }
+      }
+  }
+
+  bool INOSNMEventSource::readHeader(int64_t entry) {
+    if (!m_snm || m_snm->GetHeaderEntry(entry) <= 0) return false;
+    m_event->nevt = m_snm->nevt;
+    std::memcpy(m_event->evetime, m_snm->evetime, sizeof(m_event->evetime));
+    std::memcpy(m_event->xydata, m_snm->xydata, sizeof(m_event->xydata));
+    std::memcpy(m_event->xythit, m_snm->xythit, sizeof(m_event->xythit));
+    return true;
+  }
+
+  void INOSNMEventSource::readTDCs() {
+    if (!m_snm) return;
+    m_snm->GetTDCEntry();
+    // copy only the hits of each channel
+    for (int nj = 0; nj < nRawSides; nj++)
+      for (int ij = 0; ij < nRawLayers; ij++)
+        for (int jk = 0; jk < nRawTDCs; jk++) {
+          int nTDCHits = m_event->xythit[nj][ij][jk];
+          if (!nTDCHits) continue;
+          std::memcpy(m_event->xytime[nj][ij][jk], m_snm->xytime[nj][ij][jk], nTDCHits * sizeof(int32_t));
+          std::memcpy(m_event->plWidth[nj][ij][jk], m_snm->plWidth[nj][ij][jk], nTDCHits * sizeof(uint16_t));
+        }
+  }
+
+
+  std::unique_ptr<INOEventSource> openEventSource(const std::string& fileName) {
+    char magic[sizeof(compactHitFileMagic)] = {0};
+    std::ifstream file(fileName, std::ios::binary);
+    if (!file) {
+      std::cerr << "Error: cannot open " << fileName << "\n";
+      return nullptr;
+    }
+    file.read(magic, sizeof(magic));
+    file.close();
+
+    if (std::memcmp(magic, compactHitFileMagic, sizeof(magic)) == 0) {
+      std::unique_ptr<INOCompactEventSource> source(new INOCompactEventSource(fileName));
+      if (!source->isOpen()) return nullptr;
+      return source;
+    }
+    std::unique_ptr<INOSNMEventSource> source(new INOSNMEventSource(fileName));
+    if (!source->isOpen()) return nullptr;
+    return source;
+  }
+
+} // namespace INO
@@ -0,0 +1,81 @@
+
+#include "INOGausKernel.h"
+
+#include <cmath>
+
+using namespace INO;
+
+
+const double* INOGausKernel::getUnitTable()
+{
+  static const std::vector<double> table = [] {
+    std::vector<double> values(c_unitTableSize);
+    for (int ij = 0; ij < c_unitTableSize; ij++) {
+      double u = double(ij) / c_unitStepsPerSigma;
+      values[ij] = std::exp(-0.5 * u * u) / 2.50662827463100050; // sqrt(2*pi)
+    }
+    return values;
+  }();
+  return table.data();
+}
+
+
+void INOGausKernel::configure(double sigma, double binWidth, double sigmaN, int nPhases)
+{
+  m_sigma = sigma;
+  m_binWidth = binWidth;
+  m_sigmaN = sigmaN;
+  m_nPhases = nPhases;
+  // one more bin than the reach of the gauss, for the bin edges
+  m_halfBins = int(std::ceil(sigmaN * sigma / binWidth)) + 1;
+
+  int rowSize = 2 * m_halfBins + 1;
+  m_table.assign((nPhases + 1) * rowSize, 0.);
+  for (int phase = 0; phase <= nPhases; phase++) {
+    double centerInBin = double(phase) / nPhases; // in units of the bin width
+    for (int ij = -m_halfBins; ij <= m_halfBins; ij++) {
+      double distance = (ij + 0.5 - centerInBin) * binWidth;
+      double u = distance / sigma;
+      m_table[phase * rowSize + ij + m_halfBins] =
+        std::exp(-0.5 * u * u) / (2.50662827463100050 * sigma);
+    }
+  }
+}
+
+
+bool INOGausKernel::isConfiguredFor(double sigma, double binWidth, double sigmaN) const
+{
+  return m_nPhases > 0 && sigma == m_sigma && sigmaN == m_sigmaN &&
+         std::fabs(binWidth - m_binWidth) <= 1e-9 * m_binWidth;
+}
+
+
+void INOGausKernel::add(INOTimeHistogram& hist, double integral, double center, bool isAddition) const
+{
+  // same bins as addGausToHistogram
+  int startBin = hist.findBin(center - m_sigmaN * m_sigma);
+  int   endBin = hist.findBin(center + m_sigmaN * m_sigma);
+  if (startBin < 1) startBin = 1;
+  if (endBin > (hist.getNBins())) endBin = hist.getNBins();
+  if (startBin > endBin) return;
+
+  // bin containing the center, and the position of the center inside it
+  double position = (center - hist.getLowEdge()) / m_binWidth;
+  double floorPosition = std::floor(position);
+  int centerBin = int(floorPosition) + 1;
+  double phase = (position - floorPosition) * m_nPhases;
+  int phaseRow = int(phase);
+  if (phaseRow >= m_nPhases) phaseRow = m_nPhases - 1;
+  double fraction = phase - phaseRow;
+
+  int rowSize = 2 * m_halfBins + 1;
+  const double* row0 = &m_table[phaseRow * rowSize + startBin - centerBin + m_halfBins];
+  const double* row1 = row0 + rowSize;
+  double* bins = hist.getBinRange(startBin, endBin);
+  int nBins = endBin - startBin + 1;
+
+  double weight0 = (isAddition ? integral : -integral) * (1. - fraction);
+  double weight1 = (isAddition ? integral : -integral) * fraction;
+  for (int ij = 0; ij < nBins; ij++)
+    bins[ij] += weight0 * row0[ij] + weight1 * row1[ij];
+}
@@ -0,0 +1,173 @@
+
+#include "INOInstrumentation.h"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+
+namespace INO {
+
+  namespace {
+
+    /** Tables of one thread, added to the global ones when the thread ends */
+    struct ThreadTables {
+      std::vector<INOInstrumentation::TimerRecord> timers;
+      std::vector<int64_t> counters;
+      ~ThreadTables() { INOInstrumentation::getInstance().flushThread(); }
+    };
+
+    thread_local ThreadTables threadTables;
+
+    /** Duration below which fraction of the calls fall, from the bins */
+    uint64_t getPercentile(const INOInstrumentation::TimerRecord& record, double fraction) {
+      uint64_t nBelow = 0;
+      for (int ij = 0; ij < INOInstrumentation::nDurationBins; ij++) {
+        nBelow += record.durationBins[ij];
+        if (nBelow >= fraction * record.calls)
+          return std::min(record.maxNanoseconds, INOInstrumentation::getDurationBinEdge(ij));
+      }
+      return record.maxNanoseconds;
+    }
+
+    /** Name quoted for JSON, the names are plain identifiers with '/' */
+    std::string quote(const std::string& name) { return "\"" + name + "\""; }
+
+  } // namespace
+
+
+  INOInstrumentation::INOInstrumentation() : m_start(std::chrono::steady_clock::now()) {}
+
+  INOInstrumentation& INOInstrumentation::getInstance() {
+    static INOInstrumentation instance;
+    return instance;
+  }
+
+  int INOInstrumentation::registerTimer(const char* name) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = std::find(m_timerNames.begin(), m_timerNames.end(), name);
+    if (it != m_timerNames.end()) return it - m_timerNames.begin();
+    m_timerNames.push_back(name);
+    m_timers.emplace_back();
+    return m_timerNames.size() - 1;
+  }
+
+  int INOInstrumentation::registerCounter(const char* name) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = std::find(m_counterNames.begin(), m_counterNames.end(), name);
+    if (it != m_counterNames.end()) return it - m_counterNames.begin();
+    m_counterNames.push_back(name);
+    m_counters.push_back(0);
+    return m_counterNames.size() - 1;
+  }
+
+  int INOInstrumentation::getDurationBin(uint64_t nanoseconds) {
+    if (nanoseconds < 8) return nanoseconds;
+    int msb = 63 - __builtin_clzll(nanoseconds);
+    // 8 bins between 2^msb and 2^(msb+1)
+    return 8 * (msb - 2) + ((nanoseconds >> (msb - 3)) & 7);
+  }
+
+  uint64_t INOInstrumentation::getDurationBinEdge(int bin) {
+    if (bin < 8) return bin + 1;
+    int msb = bin / 8 + 2;
+    uint64_t width = uint64_t(1) << (msb - 3);
+    return (uint64_t(8 + bin % 8) << (msb - 3)) + width;
+  }
+
+  void INOInstrumentation::recordTimer(int id, uint64_t nanoseconds, uint64_t allocations) {
+    auto& timers = threadTables.timers;
+    if (id >= int(timers.size())) timers.resize(id + 1);
+    TimerRecord& record = timers[id];
+    record.calls++;
+    record.totalNanoseconds += nanoseconds;
+    record.maxNanoseconds = std::max(record.maxNanoseconds, nanoseconds);
+    record.allocations += allocations;
+    record.durationBins[getDurationBin(nanoseconds)]++;
+  }
+
+  void INOInstrumentation::addToCounter(int id, int64_t n) {
+    auto& counters = threadTables.counters;
+    if (id >= int(counters.size())) counters.resize(id + 1, 0);
+    counters[id] += n;
+  }
+
+  void INOInstrumentation::flushThread() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto& timers = threadTables.timers;
+    for (size_t id = 0; id < timers.size(); id++) {
+      TimerRecord& record = m_timers[id];
+      record.calls += timers[id].calls;
+      record.totalNanoseconds += timers[id].totalNanoseconds;
+      record.maxNanoseconds = std::max(record.maxNanoseconds, timers[id].maxNanoseconds);
+      record.allocations += timers[id].allocations;
+      for (int ij = 0; ij < nDurationBins; ij++) record.durationBins[ij] += timers[id].durationBins[ij];
+    }
+    auto& counters = threadTables.counters;
+    for (size_t id = 0; id < counters.size(); id++) m_counters[id] += counters[id];
+    timers.clear();
+    counters.clear();
+  }
+
+  bool INOInstrumentation::writeSummary(const std::string& fileName) {
+    // the other threads of the job have ended and flushed already
+    flushThread();
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::ofstream out(fileName);
+    if (!out) {
+      std::cerr << "Error: cannot write instrumentation summary " << fileName << "\n";
+      return false;
+    }
+
+    int64_t nEvents = 0;
+    for (size_t id = 0; id < m_counterNames.size(); id++)
+      if (m_counterNames[id] == "events") nEvents = m_counters[id];
+    double eventsPerSecond = wallSeconds > 0 ? nEvents / wallSeconds : 0;
+
+    bool isCSV = fileName.size() >= 4 && fileName.compare(fileName.size() - 4, 4, ".csv") == 0;
+    out << std::setprecision(6);
+    if (isCSV) {
+      out << "name,calls,totalSeconds,meanNs,p50Ns,p90Ns,p99Ns,maxNs,allocationsPerCall\n";
+      for (size_t id = 0; id < m_timerNames.size(); id++) {
+        const TimerRecord& record = m_timers[id];
+        double calls = std::max<uint64_t>(1, record.calls);
+        out << m_timerNames[id] << "," << record.calls << "," << record.totalNanoseconds * 1e-9 << ","
+            << record.totalNanoseconds / calls << "," << getPercentile(record, 0.5) << ","
+            << getPercentile(record, 0.9) << "," << getPercentile(record, 0.99) << ","
+            << record.maxNanoseconds << "," << record.allocations / calls << "\n";
+      }
+      // the job totals and the counters as name,value rows
+      out << "wallSeconds," << wallSeconds << "\n";
+      out << "eventsPerSecond," << eventsPerSecond << "\n";
+      for (size_t id = 0; id < m_counterNames.size(); id++)
+        out << "counter:" << m_counterNames[id] << "," << m_counters[id] << "\n";
+    } else {
+      out << "{\n"
+          << "  \"wallSeconds\": " << wallSeconds << ",\n"
+          << "  \"events\": " << nEvents << ",\n"
+          << "  \"eventsPerSecond\": " << eventsPerSecond << ",\n"
+          << "  \"timers\": [";
+      for (size_t id = 0; id < m_timerNames.size(); id++) {
+        const TimerRecord& record = m_timers[id];
+        double calls = std::max<uint64_t>(1, record.calls);
+        out << (id ? "," : "") << "\n    {\"name\": " << quote(m_timerNames[id])
+            << ", \"calls\": " << record.calls
+            << ", \"totalSeconds\": " << record.totalNanoseconds * 1e-9
+            << ", \"meanNs\": " << record.totalNanoseconds / calls
+            << ", \"p50Ns\": " << getPercentile(record, 0.5)
+            << ", \"p90Ns\": " << getPercentile(record, 0.9)
+            << ", \"p99Ns\": " << getPercentile(record, 0.99)
+            << ", \"maxNs\": " << record.maxNanoseconds
+            << ", \"allocationsPerCall\": " << record.allocations / calls << "}";
+      }
+      out << "\n  ],\n  \"counters\": {";
+      for (size_t id = 0; id < m_counterNames.size(); id++)
+        out << (id ? ", " : "") << quote(m_counterNames[id]) << ": " << m_counters[id];
+      out << "}\n}\n";
+    }
+    return true;
+  }
+
+} // namespace INO
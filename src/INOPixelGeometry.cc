@@ -0,0 +1,102 @@
+#include "INOPixelGeometry.h"
+#include "INOCalibrationManager.h"
+
+#include <TMath.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace INO;
+
+INOPixelGeometry::INOPixelGeometry(double stripWidth, double layerPitch, double zShift,
+                                   bool invertRotation)
+  : m_stripWidth(stripWidth), m_layerPitch(layerPitch), m_zShift(zShift),
+    m_rotationSign(invertRotation ? -1 : 1),
+    m_positions(nPixelIndices) {
+  INOCalibrationManager& inoCalibrationManager = INOCalibrationManager::getInstance();
+  for (int module = 0; module < nModules; module++)
+    for (int row = 0; row < nRows; row++)
+      for (int column = 0; column < nColumns; column++)
+        for (int layer = 0; layer < nLayers; layer++) {
+          // the layer is made of four detectors, one per half in x and y
+          TVector3 rpcPosition[2][2], rpcOrientation[2][2];
+          for (int x : {0, 1})
+            for (int y : {0, 1})
+              inoCalibrationManager.getLayerPosition({module, row, column, layer}, x, y,
+                                                     rpcPosition[x][y], rpcOrientation[x][y]);
+          for (int xStrip = 0; xStrip < nStrips; xStrip++)
+            for (int yStrip = 0; yStrip < nStrips; yStrip++) {
+              PixelId pixelId = {module, row, column, layer, {xStrip, yStrip}};
+              int x = xStrip < 32 ? 0 : 1;
+              int y = yStrip < 32 ? 0 : 1;
+              TVector3 position = computePosition(pixelId, rpcPosition[x][y], rpcOrientation[x][y]);
+              m_positions[getPixelIndex(pixelId)] = {position.X(), position.Y(), position.Z()};
+            }
+        }
+}
+
+TVector3 INOPixelGeometry::getPosition(const PixelId& pixelId) const {
+  int index = getPixelIndex(pixelId);
+  if (index >= 0) {
+    const auto& position = m_positions[index];
+    return TVector3(position[0], position[1], position[2]);
+  }
+  // outside the table, compute it directly
+  TVector3 rpcPosition, rpcOrientation;
+  INOCalibrationManager::getInstance()
+    .getLayerPosition({pixelId.module, pixelId.row, pixelId.column, pixelId.layer},
+                      pixelId.strip[0] < 32 ? 0 : 1,
+                      pixelId.strip[1] < 32 ? 0 : 1,
+                      rpcPosition, rpcOrientation);
+  return computePosition(pixelId, rpcPosition, rpcOrientation);
+}
+
+bool INOPixelGeometry::findPixel(const LayerId& layerId, double x, double y, PixelId& pixelId) const {
+  const int quadrantStrips = nStrips / 2;
+  bool isFound = false;
+  double bestDistance2 = 0;
+  for (int qx : {0, 1})
+    for (int qy : {0, 1}) {
+      // the grid of the quadrant, its first pixel and the steps of one strip
+      PixelId first = {layerId.module, layerId.row, layerId.column, layerId.layer,
+                       {qx * quadrantStrips, qy * quadrantStrips}};
+      PixelId nextX = first, nextY = first;
+      nextX.strip[0]++;
+      nextY.strip[1]++;
+      TVector3 origin = getPosition(first);
+      TVector3 stepX = getPosition(nextX) - origin;
+      TVector3 stepY = getPosition(nextY) - origin;
+      double dx = x - origin.X(), dy = y - origin.Y();
+      double determ = stepX.X() * stepY.Y() - stepX.Y() * stepY.X();
+      int strip[2] = {first.strip[0] + int(std::floor((dx * stepY.Y() - dy * stepY.X()) / determ + 0.5)),
+                      first.strip[1] + int(std::floor((stepX.X() * dy - stepX.Y() * dx) / determ + 0.5))};
+      if (strip[0] < 0 || strip[0] >= nStrips || strip[1] < 0 || strip[1] >= nStrips) continue;
+      // the nearest pixel of this quadrant
+      PixelId candidate = first;
+      for (int nj = 0; nj < 2; nj++)
+        candidate.strip[nj] = std::min(std::max(strip[nj], first.strip[nj]), first.strip[nj] + quadrantStrips - 1);
+      TVector3 position = getPosition(candidate);
+      double distance2 = (x - position.X()) * (x - position.X()) + (y - position.Y()) * (y - position.Y());
+      if (!isFound || distance2 < bestDistance2) {
+        isFound = true;
+        bestDistance2 = distance2;
+        pixelId = candidate;
+      }
+    }
+  return isFound;
+}
+
+TVector3 INOPixelGeometry::computePosition(const PixelId& pixelId,
+                                           const TVector3& rpcPosition,
+                                           const TVector3& rpcOrientation) const {
+  TVector3 rawPos = {(pixelId.strip[0] + 0.5) * m_stripWidth,
+                     (pixelId.strip[1] + 0.5) * m_stripWidth,
+                     m_layerPitch * pixelId.layer + m_zShift};
+  TVector3 offset = rpcPosition;
+  offset.SetZ(0);
+  rawPos += offset;
+  rawPos.RotateX(m_rotationSign * rpcOrientation.X() * TMath::DegToRad());
+  rawPos.RotateY(m_rotationSign * rpcOrientation.Y() * TMath::DegToRad());
+  rawPos.RotateZ(m_rotationSign * rpcOrientation.Z() * TMath::DegToRad());
+  return rawPos;
+}
@@ -0,0 +1,120 @@
+
+#include "INOPrefetchingEventSource.h"
+
+#include <iostream>
+#include <chrono>
+
+#include <TROOT.h>
+
+namespace INO {
+
+  INOPrefetchingEventSource::INOPrefetchingEventSource(std::unique_ptr<INOEventSource> source, int depth) :
+    m_source(std::move(source)), m_first(0), m_last(-1), m_nProduced(0), m_nConsumed(0),
+    m_isDone(true), m_isStopping(false), m_inputStallSeconds(0), m_outputStallSeconds(0) {
+    // the wrapped source is read by the background thread
+    ROOT::EnableThreadSafety();
+    if (depth < 1) depth = 1;
+    m_slots.resize(depth);
+    for (auto& slot : m_slots) {
+      slot.event.reset(new RawEvent);
+      slot.isRead = false;
+    }
+  }
+
+  INOPrefetchingEventSource::~INOPrefetchingEventSource() {
+    stop();
+  }
+
+  void INOPrefetchingEventSource::stop() {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_isStopping = true;
+    }
+    m_consumed.notify_all();
+    if (m_thread.joinable()) m_thread.join();
+    m_isStopping = false;
+  }
+
+  void INOPrefetchingEventSource::start(int64_t first, int64_t last) {
+    // the entries of an earlier range that were not taken are dropped
+    stop();
+    m_first = first;
+    m_last = last;
+    m_nProduced = 0;
+    m_nConsumed = 0;
+    m_isDone = first > last;
+    if (!m_isDone) m_thread = std::thread(&INOPrefetchingEventSource::prefetch, this);
+  }
+
+  void INOPrefetchingEventSource::prefetch() {
+    int depth = m_slots.size();
+    for (int64_t entry = m_first; entry <= m_last; entry++) {
+      int64_t nProduced = entry - m_first;
+      {
+        // wait for a free slot
+        auto start = std::chrono::steady_clock::now();
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_consumed.wait(lock, [&] { return m_isStopping || nProduced - m_nConsumed < depth; });
+        m_outputStallSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (m_isStopping) break;
+      }
+
+      // the slot belongs to this thread until it is published
+      Slot& slot = m_slots[nProduced % depth];
+      slot.isRead = m_source->readHeader(entry);
+      if (slot.isRead && (!m_prefilter || m_prefilter(m_source->getEvent())))
+        m_source->readTDCs();
+      if (slot.isRead) {
+        // hand the filled buffer to the slot and keep the old one for the next read
+        std::swap(slot.event, getEventBuffer(*m_source));
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_nProduced = nProduced + 1;
+      }
+      m_produced.notify_one();
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_isDone = true;
+    }
+    m_produced.notify_all();
+  }
+
+  bool INOPrefetchingEventSource::readHeader(int64_t entry) {
+    int depth = m_slots.size();
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if (entry < m_first + m_nConsumed || entry > m_last) {
+      std::cerr << "Error: entry " << entry << " was not prefetched\n";
+      return false;
+    }
+
+    // drop the skipped entries, then wait for the requested one
+    while (true) {
+      auto start = std::chrono::steady_clock::now();
+      m_produced.wait(lock, [&] { return m_nProduced > m_nConsumed || m_isDone; });
+      m_inputStallSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      if (m_nProduced == m_nConsumed) return false; // the thread stopped early
+
+      Slot& slot = m_slots[m_nConsumed % depth];
+      bool isRequested = m_first + m_nConsumed == entry;
+      bool isRead = slot.isRead;
+      // take the buffer, the slot gets the previous event for the next read
+      if (isRequested && isRead) std::swap(slot.event, m_event);
+      m_nConsumed++;
+      lock.unlock();
+      m_consumed.notify_one();
+      if (isRequested) return isRead;
+      lock.lock();
+    }
+  }
+
+  double INOPrefetchingEventSource::getOutputStallSeconds() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_outputStallSeconds;
+  }
+
+} // namespace INO
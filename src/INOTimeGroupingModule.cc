@@ -1,5 +1,9 @@
 
 #include "INOTimeGroupingModule.h"
+#include "INOInstrumentation.h"
+
+// std
+#include <algorithm>
 
 // root
 #include <TString.h>
@@ -8,17 +12,24 @@ using namespace INO;
 
 
 INOTimeGroupingModule::INOTimeGroupingModule(std::shared_ptr<INOEvent> data) :
-  m_inoEvent(data)
+  m_inoEvent(data),
+  m_fitHistogram("h_clsTimeFit", "h_clsTimeFit", 1, 0., 1.)
 {
+  m_fitHistogram.SetDirectory(0);
+
+  m_usedPars.groupingEngine = c_histogramPeaks;
+  m_usedPars.useStripClusters = false;
+  m_usedPars.sweepMaxGap = 10.0;
+  m_usedPars.sweepMaxWidth = 50.0;
   // Fill time Histogram:
-  m_usedPars.tRange[0] = data->getLowestCalibratedLeadingTime();
-  m_usedPars.tRange[1] = data->getHighestCalibratedLeadingTime();
+  // tRange is taken from the event in process()
   m_usedPars.rebinningFactor = 1.0;
   m_usedPars.fillSigmaN = 7.0;
   // Search peaks:
   m_usedPars.limitSigma[0] = 1.0;
   m_usedPars.limitSigma[1] = 20.0;
   m_usedPars.fitRangeHalfWidth = 5.0;
+  m_usedPars.peakEstimator = c_gausFit;
   m_usedPars.removeSigmaN = 7.0;
   m_usedPars.fracThreshold = 0.25;
   m_usedPars.maxGroups = 20;
@@ -38,34 +49,70 @@ INOTimeGroupingModule::INOTimeGroupingModule(std::shared_ptr<INOEvent> data) :
 
 void INOTimeGroupingModule::process()
 {
+  INO_SCOPED_TIMER("group");
   if (int(m_inoEvent->getEntries()) < 4) return;
 
-  // declare and fill the histogram shaping each cluster with a normalised gaussian
-  // G(cluster time, resolution)
-  TH1D h_clsTime;
-  createAndFillHistorgram(h_clsTime);
-
-  // h_clsTime.SaveAs("test.root");
+  // the event may have been refilled since the last call
+  m_usedPars.tRange[0] = m_inoEvent->getLowestCalibratedLeadingTime();
+  m_usedPars.tRange[1] = m_inoEvent->getHighestCalibratedLeadingTime();
+  if (m_usedPars.useStripClusters) {
+    findClusters(*m_inoEvent, m_clusters);
+    m_clusterTimes.clear();
+    m_clusterTimeOffsets.clear();
+    for (const auto& cluster : m_clusters) {
+      m_clusterTimeOffsets.push_back(m_clusterTimes.size());
+      collectClusterTimes(*m_inoEvent, cluster, m_oneClusterTimes);
+      m_clusterTimes.insert(m_clusterTimes.end(), m_oneClusterTimes.begin(), m_oneClusterTimes.end());
+    }
+    m_clusterTimeOffsets.push_back(m_clusterTimes.size());
+  }
 
-  // now we search for peaks and when we find one we remove it from the distribution, one by one.
   std::vector<GroupInfo> groupInfoVector; // Gauss parameters (integral, center, sigma)
+  double tRangeLow  = m_usedPars.tRange[0] - 100.0;
+  double tRangeHigh = m_usedPars.tRange[1] + 100.0;
+
+  if (m_usedPars.groupingEngine == c_sortAndSweep) {
+
+    // groups straight from the sorted strip times, no histogram
+    INO_SCOPED_TIMER("group/sweep");
+    sweepSortedTimes(groupInfoVector);
 
-  // performing the search
-  searchGausPeaksInHistogram(h_clsTime, groupInfoVector);
-  // resize to max
-  resizeToMaxSize(groupInfoVector);
-  // sorting background groups
-  sortBackgroundGroups(groupInfoVector);
-  // sorting signal groups
-  sortSignalGroups(groupInfoVector);
+  } else {
+
+    // declare and fill the histogram shaping each cluster with a normalised gaussian
+    // G(cluster time, resolution)
+    {
+      INO_SCOPED_TIMER("group/fill");
+      createAndFillHistorgram(m_timeHistogram);
+    }
+    tRangeLow  = m_timeHistogram.getLowEdge();
+    tRangeHigh = m_timeHistogram.getHighEdge();
+
+    // h_clsTime.SaveAs("test.root");
+
+    // now we search for peaks and when we find one we remove it from the distribution, one by one.
+    INO_SCOPED_TIMER("group/search");
+    searchGausPeaksInHistogram(m_timeHistogram, groupInfoVector);
+  }
+
+  {
+    INO_SCOPED_TIMER("group/sort");
+    // resize to max
+    resizeToMaxSize(groupInfoVector);
+    // sorting background groups
+    sortBackgroundGroups(groupInfoVector);
+    // sorting signal groups
+    sortSignalGroups(groupInfoVector);
+  }
 
   // assign the groupID to clusters
-  assignGroupIdsToClusters(h_clsTime, groupInfoVector);
+  INO_SCOPED_TIMER("group/assign");
+  assignGroupIdsToClusters(tRangeLow, tRangeHigh, groupInfoVector);
 
 } // end of event
 
 
-void INOTimeGroupingModule::createAndFillHistorgram(TH1D& hist)
+void INOTimeGroupingModule::createAndFillHistorgram(INOTimeHistogram& hist)
 {
 
   // minimise the range of the histogram removing empty bins at the edge
@@ -78,25 +125,26 @@ void INOTimeGroupingModule::createAndFillHistorgram(TH1D& hist)
   if (nBin < 1) nBin = 1;
   nBin *= m_usedPars.rebinningFactor;
   if (nBin < 2) nBin = 2;
+  // the upper edge is moved so that the bin width is always 1/rebinningFactor,
+  // this lets the same gauss kernel be used for every event
+  tRangeHigh = tRangeLow + nBin / m_usedPars.rebinningFactor;
   // B2DEBUG(21, "tRange: [" << tRangeLow << "," << tRangeHigh << "], nBin: " << nBin);
 
-  hist = TH1D("h_clsTime", "h_clsTime", nBin, tRangeLow, tRangeHigh);
-  hist.GetXaxis()->SetLimits(tRangeLow, tRangeHigh);
+  hist.reset(nBin, tRangeLow, tRangeHigh);
 
-  for (auto hit : m_inoEvent->getHits()) {
-    auto stripId = hit->stripId;
-    auto stripTimes = m_inoEvent->getCalibratedLeadingTimes(stripId);
-    for (auto stripTime : stripTimes) {
-      double gSigma  = m_usedPars.clsSigma;
-      // adding/filling a gauss to histogram
-      addGausToHistogram(hist, 1., stripTime, gSigma, m_usedPars.fillSigmaN);
-    }
-  }
+  double gSigma  = m_usedPars.clsSigma;
+  if (!m_fillKernel.isConfiguredFor(gSigma, hist.getBinWidth(), m_usedPars.fillSigmaN))
+    m_fillKernel.configure(gSigma, hist.getBinWidth(), m_usedPars.fillSigmaN);
+
+  forEachGroupedTime([&](double stripTime) {
+    // adding/filling a gauss to histogram
+    m_fillKernel.add(hist, 1., stripTime);
+  });
 
 } // end of createAndFillHistorgram
 
 
-void INOTimeGroupingModule::searchGausPeaksInHistogram(TH1D& hist, std::vector<GroupInfo>& groupInfoVector)
+void INOTimeGroupingModule::searchGausPeaksInHistogram(INOTimeHistogram& hist, std::vector<GroupInfo>& groupInfoVector)
 {
 
   double maxPeak     = 0.;  //   height of the highest peak in signal region [expectedSignalTimeMin, expectedSignalTimeMax]
@@ -107,9 +155,9 @@ void INOTimeGroupingModule::searchGausPeaksInHistogram(TH1D& hist, std::vector<G
   while (!amDone) {
 
     // take the bin corresponding to the highest peak
-    int    maxBin        = hist.GetMaximumBin();
-    double maxBinCenter  = hist.GetBinCenter(maxBin);
-    double maxBinContent = hist.GetBinContent(maxBin);
+    int    maxBin        = hist.getMaximumBin();
+    double maxBinCenter  = hist.getBinCenter(maxBin);
+    double maxBinContent = hist.getBinContent(maxBin);
 
     // Set maxPeak for the first time
     if (maxPeak == 0 &&
@@ -118,39 +166,29 @@ void INOTimeGroupingModule::searchGausPeaksInHistogram(TH1D& hist, std::vector<G
     // we are done if the the height of the this peak is below threshold
     if (maxPeak != 0 && maxBinContent < maxPeak * m_usedPars.fracThreshold) { amDone = true; continue;}
 
-    // preparing the gauss function for fitting the peak
-    TF1 ngaus("ngaus", myGaus,
-              hist.GetXaxis()->GetXmin(), hist.GetXaxis()->GetXmax(), 3);
-
-    // setting the parameters according to the maxBinCenter and maxBinContnet
+    // integral of a gauss with the height of the peak and fitRangeHalfWidth as sigma
     double maxPar0 = maxBinContent * 2.50662827 * m_usedPars.fitRangeHalfWidth; // sqrt(2*pi) = 2.50662827
-    ngaus.SetParameter(0, maxBinContent);
-    ngaus.SetParLimits(0,
-                       maxPar0 * 0.01,
-                       maxPar0 * 2.);
-    ngaus.SetParameter(1, maxBinCenter);
-    ngaus.SetParLimits(1,
-                       maxBinCenter - m_usedPars.fitRangeHalfWidth * 0.2,
-                       maxBinCenter + m_usedPars.fitRangeHalfWidth * 0.2);
-    ngaus.SetParameter(2, m_usedPars.fitRangeHalfWidth);
-    ngaus.SetParLimits(2,
-                       m_usedPars.limitSigma[0],
-                       m_usedPars.limitSigma[1]);
-
-
-    // fitting the gauss at the peak the in range [-fitRangeHalfWidth, fitRangeHalfWidth]
-    int status = hist.Fit("ngaus", "NQ0", "",
-                          maxBinCenter - m_usedPars.fitRangeHalfWidth,
-                          maxBinCenter + m_usedPars.fitRangeHalfWidth);
+    double pars[3] = {0, 0, 0};
+    int status = 0;
 
+    if (m_usedPars.peakEstimator == c_gausFit) {
 
-    if (!status) {    // if fit converges
+      status = fitPeak(hist, maxBin, maxPar0, pars);
+
+    } else {
 
-      double pars[3] = {
-        ngaus.GetParameter(0),     // integral
-        ngaus.GetParameter(1),     // center
-        std::fabs(ngaus.GetParameter(2)) // sigma
-      };
+      status = estimatePeakWithoutFit(hist, maxBin, pars);
+
+      // same limits as the fit parameters, sigma is checked below
+      pars[0] = std::min(std::max(pars[0], maxPar0 * 0.01), maxPar0 * 2.);
+      pars[1] = std::min(std::max(pars[1], maxBinCenter - m_usedPars.fitRangeHalfWidth * 0.2),
+                         maxBinCenter + m_usedPars.fitRangeHalfWidth * 0.2);
+      pars[2] = std::min(std::max(pars[2], double(m_usedPars.limitSigma[0])),
+                         double(m_usedPars.limitSigma[1]));
+    }
+
+
+    if (!status) {    // if fit converges
 
       // fit converges but parameters are at limit
       // Do a rough cleaning
@@ -188,6 +226,173 @@ void INOTimeGroupingModule::searchGausPeaksInHistogram(TH1D& hist, std::vector<G
 
 
 
+int INOTimeGroupingModule::fitPeak(const INOTimeHistogram& hist, int maxBin, double maxPar0, double pars[3])
+{
+  double maxBinCenter  = hist.getBinCenter(maxBin);
+  double maxBinContent = hist.getBinContent(maxBin);
+
+  // copy the bins around the peak, with a margin beyond the fit range
+  int halfBins = int(std::ceil(m_usedPars.fitRangeHalfWidth / hist.getBinWidth())) + 2;
+  int firstBin = std::max(1, maxBin - halfBins);
+  int  lastBin = std::min(hist.getNBins(), maxBin + halfBins);
+  m_fitHistogram.Reset();
+  m_fitHistogram.SetBins(lastBin - firstBin + 1, hist.getBinLowEdge(firstBin), hist.getBinLowEdge(lastBin + 1));
+  for (int ijx = firstBin; ijx <= lastBin; ijx++)
+    m_fitHistogram.SetBinContent(ijx - firstBin + 1, hist.getBinContent(ijx));
+
+  // preparing the gauss function for fitting the peak, kept out of the
+  // global list of functions so that modules on other threads do not see it
+  TF1 ngaus("ngaus", myGaus,
+            hist.getLowEdge(), hist.getHighEdge(), 3, 1, TF1::EAddToList::kNo);
+
+  // setting the parameters according to the maxBinCenter and maxBinContnet
+  ngaus.SetParameter(0, maxBinContent);
+  ngaus.SetParLimits(0,
+                     maxPar0 * 0.01,
+                     maxPar0 * 2.);
+  ngaus.SetParameter(1, maxBinCenter);
+  ngaus.SetParLimits(1,
+                     maxBinCenter - m_usedPars.fitRangeHalfWidth * 0.2,
+                     maxBinCenter + m_usedPars.fitRangeHalfWidth * 0.2);
+  ngaus.SetParameter(2, m_usedPars.fitRangeHalfWidth);
+  ngaus.SetParLimits(2,
+                     m_usedPars.limitSigma[0],
+                     m_usedPars.limitSigma[1]);
+
+
+  // fitting the gauss at the peak the in range [-fitRangeHalfWidth, fitRangeHalfWidth]
+  int status = m_fitHistogram.Fit(&ngaus, "NQ0", "",
+                                maxBinCenter - m_usedPars.fitRangeHalfWidth,
+                                maxBinCenter + m_usedPars.fitRangeHalfWidth);
+
+  pars[0] = ngaus.GetParameter(0);     // integral
+  pars[1] = ngaus.GetParameter(1);     // center
+  pars[2] = std::fabs(ngaus.GetParameter(2)); // sigma
+  return status;
+
+} // end of fitPeak
+
+
+int INOTimeGroupingModule::estimatePeakWithoutFit(const INOTimeHistogram& hist, int maxBin, double pars[3])
+{
+  double binWidth = hist.getBinWidth();
+  double maxBinCenter = hist.getBinCenter(maxBin);
+
+  if (m_usedPars.peakEstimator == c_logParabola) {
+
+    if (maxBin <= 1 || maxBin >= hist.getNBins()) return 1;
+    double yLow  = hist.getBinContent(maxBin - 1);
+    double yMax  = hist.getBinContent(maxBin);
+    double yHigh = hist.getBinContent(maxBin + 1);
+    if (yLow <= 0 || yMax <= 0 || yHigh <= 0) return 1;
+
+    // ln(y) = a + b*u + c*u^2 with u in bins from the maximum bin
+    double a = std::log(yMax);
+    double b = 0.5 * (std::log(yHigh) - std::log(yLow));
+    double c = 0.5 * (std::log(yHigh) + std::log(yLow)) - a;
+    if (c >= 0) return 1;
+
+    double sigma  = std::sqrt(-0.5 / c) * binWidth;
+    double height = std::exp(a - b * b / (4 * c));
+    pars[0] = height * sigma * 2.50662827; // sqrt(2*pi) = 2.50662827
+    pars[1] = maxBinCenter - b / (2 * c) * binWidth;
+    pars[2] = sigma;
+    return 0;
+  }
+
+  // weighted moments of the bins whose centres are in the fit range
+  double halfWidth = m_usedPars.fitRangeHalfWidth;
+  int startBin = std::max(1, hist.findBin(maxBinCenter - halfWidth));
+  int   endBin = std::min(hist.getNBins(), hist.findBin(maxBinCenter + halfWidth));
+  double sumW = 0, sumWX = 0, sumWX2 = 0;
+  for (int ijx = startBin; ijx <= endBin; ijx++) {
+    double x = hist.getBinCenter(ijx) - maxBinCenter;
+    if (std::fabs(x) > halfWidth) continue;
+    double w = hist.getBinContent(ijx);
+    if (w <= 0) continue;
+    sumW   += w;
+    sumWX  += w * x;
+    sumWX2 += w * x * x;
+  }
+  if (sumW <= 0) return 1;
+  double mean = sumWX / sumW;
+  // binning adds binWidth^2/12 to the variance (Sheppard)
+  double truncatedVariance = sumWX2 / sumW - mean * mean - binWidth * binWidth / 12.;
+  if (truncatedVariance <= 0) return 1;
+
+  // The used bins cover +-h around the maximum bin, h = halfWidth + binWidth/2.
+  // A gauss cut at +-h has variance sigma^2 * (1 - 2 k phi(k) / (2 Phi(k) - 1)), k = h / sigma.
+  // Solve for sigma by fixed-point iteration, starting from the truncated value.
+  halfWidth += 0.5 * binWidth;
+  double sigma = std::sqrt(truncatedVariance);
+  double fraction = 1;
+  for (int iter = 0; iter < 20; iter++) {
+    double k = halfWidth / sigma;
+    fraction = std::erf(k / 1.41421356);                      // 2 Phi(k) - 1
+    double shrink = 1 - 2 * k * std::exp(-0.5 * k * k) / 2.50662827 / fraction;
+    if (shrink <= 0.05) return 1; // the peak is flatter than the range, no estimate
+    double newSigma = std::sqrt(truncatedVariance / shrink);
+    if (std::fabs(newSigma - sigma) < 1e-4 * sigma) { sigma = newSigma; break; }
+    sigma = newSigma;
+  }
+  fraction = std::erf(halfWidth / sigma / 1.41421356);
+
+  pars[0] = sumW * binWidth / fraction;
+  pars[1] = maxBinCenter + mean;
+  pars[2] = sigma;
+  return 0;
+
+} // end of estimatePeakWithoutFit
+
+
+void INOTimeGroupingModule::sweepSortedTimes(std::vector<GroupInfo>& groupInfoVector)
+{
+  m_sortedTimes.clear();
+  forEachGroupedTime([&](double stripTime) { m_sortedTimes.push_back(stripTime); });
+  std::sort(m_sortedTimes.begin(), m_sortedTimes.end());
+
+  // the time of each strip is smeared by clsSigma, as in the histogram
+  double clsVariance = m_usedPars.clsSigma * m_usedPars.clsSigma;
+
+  int nTimes = m_sortedTimes.size();
+  int first = 0;
+  while (first < nTimes) {
+    int last = first;
+    while (last + 1 < nTimes &&
+           m_sortedTimes[last + 1] - m_sortedTimes[last] <= m_usedPars.sweepMaxGap &&
+           m_sortedTimes[last + 1] - m_sortedTimes[first] <= m_usedPars.sweepMaxWidth)
+      last++;
+
+    double count = last - first + 1;
+    double sum = 0, sum2 = 0;
+    for (int ij = first; ij <= last; ij++) {
+      double dt = m_sortedTimes[ij] - m_sortedTimes[first];
+      sum  += dt;
+      sum2 += dt * dt;
+    }
+    double mean = sum / count;
+    double variance = std::max(sum2 / count - mean * mean, 0.);
+    double sigma = std::sqrt(variance + clsVariance);
+    sigma = std::min(std::max(sigma, double(m_usedPars.limitSigma[0])), double(m_usedPars.limitSigma[1]));
+
+    groupInfoVector.push_back(GroupInfo(count, m_sortedTimes[first] + mean, sigma));
+    first = last + 1;
+  }
+
+  // largest groups first, like the order of the peak search
+  std::stable_sort(groupInfoVector.begin(), groupInfoVector.end(),
+  [](const GroupInfo & a, const GroupInfo & b) { return std::get<0>(a) > std::get<0>(b); });
+
+  int nKept = 0;
+  double largest = groupInfoVector.empty() ? 0. : std::get<0>(groupInfoVector[0]);
+  while (nKept < int(groupInfoVector.size()) && nKept < m_usedPars.maxGroups &&
+         std::get<0>(groupInfoVector[nKept]) >= largest * m_usedPars.fracThreshold)
+    nKept++;
+  groupInfoVector.resize(nKept);
+
+} // end of sweepSortedTimes
+
+
 void INOTimeGroupingModule::sortBackgroundGroups(std::vector<GroupInfo>& groupInfoVector)
 {
   GroupInfo keyGroup;
@@ -250,81 +455,141 @@ void INOTimeGroupingModule::sortSignalGroups(std::vector<GroupInfo>& groupInfoVe
 }
 
 
-void INOTimeGroupingModule::assignGroupIdsToClusters(TH1D& hist, std::vector<GroupInfo>& groupInfoVector)
+void INOTimeGroupingModule::assignGroupIdsToClusters(double tRangeLow, double tRangeHigh,
+                                                     std::vector<GroupInfo>& groupInfoVector)
 {
-  int totClusters = m_inoEvent->getEntries();
-  double tRangeLow  = hist.GetXaxis()->GetXmin();
-  double tRangeHigh = hist.GetXaxis()->GetXmax();
+  int nGroups = groupInfoVector.size();
 
   // assign all clusters groupId = -1 if no groups are found
-  if (int(groupInfoVector.size()) == 0)
-    for (auto hit : m_inoEvent->getHits()) {
-      auto stripId = hit->stripId;
-      m_inoEvent->setTimeGroupId(stripId).push_back(-1);
+  if (nGroups == 0) {
+    for (const auto& hit : m_inoEvent->getHitRange())
+      m_inoEvent->setTimeGroupId(hit.stripId).push_back(-1);
+    return;
+  }
+
+  // acceptance range of each group, the clusters falling within 5(default) sigma of group center.
+  // some groups may be dummy, ie, (0,0,0). they accept nothing.
+  // the leftover clusters are given a groupId with the last group.
+  int nWords = (nGroups + 63) / 64;
+  m_acceptanceEdges.clear();
+  for (const auto& group : groupInfoVector) {
+    double center = std::get<1>(group), sigma = std::get<2>(group);
+    if (sigma == 0) continue;
+    double lowestAcceptedTime  = std::max(center - m_usedPars.acceptSigmaN * sigma, tRangeLow);
+    double highestAcceptedTime = std::min(center + m_usedPars.acceptSigmaN * sigma, tRangeHigh);
+    if (!(lowestAcceptedTime <= highestAcceptedTime)) continue;
+    m_acceptanceEdges.push_back(lowestAcceptedTime);
+    m_acceptanceEdges.push_back(highestAcceptedTime);
+  }
+  std::sort(m_acceptanceEdges.begin(), m_acceptanceEdges.end());
+  m_acceptanceEdges.erase(std::unique(m_acceptanceEdges.begin(), m_acceptanceEdges.end()), m_acceptanceEdges.end());
+  int nEdges = m_acceptanceEdges.size();
+
+  m_cellGroupMasks.assign((2 * nEdges + 1) * nWords, 0);
+  for (int ij = 0; ij < nGroups; ij++) {
+    double center = std::get<1>(groupInfoVector[ij]), sigma = std::get<2>(groupInfoVector[ij]);
+    if (sigma == 0) continue;
+    double lowestAcceptedTime  = std::max(center - m_usedPars.acceptSigmaN * sigma, tRangeLow);
+    double highestAcceptedTime = std::min(center + m_usedPars.acceptSigmaN * sigma, tRangeHigh);
+    if (!(lowestAcceptedTime <= highestAcceptedTime)) continue;
+    int firstCell = 2 * (std::lower_bound(m_acceptanceEdges.begin(), m_acceptanceEdges.end(), lowestAcceptedTime)
+                         - m_acceptanceEdges.begin()) + 1;
+    int  lastCell = 2 * (std::lower_bound(m_acceptanceEdges.begin(), m_acceptanceEdges.end(), highestAcceptedTime)
+                         - m_acceptanceEdges.begin()) + 1;
+    for (int cell = firstCell; cell <= lastCell; cell++)
+      m_cellGroupMasks[cell * nWords + (ij >> 6)] |= uint64_t(1) << (ij & 63);
+  }
+
+  // now loop once over all the clusters
+  if (m_usedPars.useStripClusters) {
+    // the groups of the times of each cluster, copied to its other strips
+    for (int ij = 0; ij < int(m_clusters.size()); ij++) {
+      const StripCluster& cluster = m_clusters[ij];
+      const SideId& sideId = cluster.sideId;
+      StripId firstStripId = {sideId.module, sideId.row, sideId.column, sideId.layer, sideId.side, cluster.firstStrip};
+      assignGroupIdsToTimes(firstStripId, m_clusterTimes.data() + m_clusterTimeOffsets[ij],
+                            m_clusterTimeOffsets[ij + 1] - m_clusterTimeOffsets[ij],
+                            tRangeLow, tRangeHigh, groupInfoVector);
+      for (int strip = cluster.firstStrip + 1; strip < cluster.firstStrip + cluster.size; strip++) {
+        StripId stripId = firstStripId;
+        stripId.strip = strip;
+        m_inoEvent->setTimeGroupId(stripId) = m_inoEvent->getTimeGroupId(firstStripId);
+        m_inoEvent->setTimeGroupInfo(stripId) = m_inoEvent->getTimeGroupInfo(firstStripId);
+      }
     }
+  } else {
+    for (const auto& hit : m_inoEvent->getHitRange())
+      assignGroupIdsToTimes(hit.stripId, hit.calibratedTimes[0].data(), hit.calibratedTimes[0].size(),
+                            tRangeLow, tRangeHigh, groupInfoVector);
+  }
+
+}
+
 
-  // loop over all the groups
-  // some groups may be dummy, ie, (0,0,0). they are skipped
-  for (int ij = 0; ij < int(groupInfoVector.size()); ij++) {
-
-    double pars[3] = {
-      std::get<0>(groupInfoVector[ij]),
-      std::get<1>(groupInfoVector[ij]),
-      std::get<2>(groupInfoVector[ij])
-    };
-
-    if (pars[2] == 0 && ij != int(groupInfoVector.size()) - 1) continue;
-    // do not continue the last loop.
-    // we assign the group Id to leftover clusters at the last loop.
-
-    // for this group, accept the clusters falling within 5(default) sigma of group center
-    double lowestAcceptedTime  = pars[1] - m_usedPars.acceptSigmaN * pars[2];
-    double highestAcceptedTime = pars[1] + m_usedPars.acceptSigmaN * pars[2];
-    if (lowestAcceptedTime < tRangeLow)   lowestAcceptedTime  = tRangeLow;
-    if (highestAcceptedTime > tRangeHigh) highestAcceptedTime = tRangeHigh;
-    // B2DEBUG(21, " group " << ij
-    //         << " lowestAcceptedTime " << lowestAcceptedTime
-    //         << " highestAcceptedTime " << highestAcceptedTime);
-
-    // now loop over all the clusters to check which clusters fall in this range
-    for (auto hit : m_inoEvent->getHits()) {
-      auto stripId = hit->stripId;
-      auto stripTimes = m_inoEvent->getCalibratedLeadingTimes(stripId);
-      for (auto stripTime : stripTimes) {
-
-        if (pars[2] != 0 &&   // if the last group is dummy, we straight go to leftover clusters
-            stripTime >= lowestAcceptedTime && stripTime <= highestAcceptedTime) {
-
-          // assigning groupId starting from 0
-          m_inoEvent->setTimeGroupId(stripId).push_back(ij);
-
-          // writing group info to clusters.
-          // this is independent of group id, that means,
-          if (m_usedPars.writeGroupInfo)
-            m_inoEvent->setTimeGroupInfo(stripId).push_back(GroupInfo(pars[0], pars[1], pars[2]));
-
-          // std::cout << "   accepted cluster " << " stripTime " << stripTime
-          //           << " GroupId " << m_inoEvent->getTimeGroupId(stripId).back() << std::endl;
-
-        } else {
-
-          if (ij == int(groupInfoVector.size()) - 1 && // we are now at the last loop
-              int(m_inoEvent->getTimeGroupId(stripId).size()) == 0) { // leftover clusters
-
-            if (m_usedPars.includeOutOfRangeClusters && stripTime < tRangeLow)
-              m_inoEvent->setTimeGroupId(stripId).push_back(m_usedPars.maxGroups + 1);  // underflow
-            else if (m_usedPars.includeOutOfRangeClusters && stripTime > tRangeHigh)
-              m_inoEvent->setTimeGroupId(stripId).push_back(m_usedPars.maxGroups + 2);  // overflow
-            else
-              m_inoEvent->setTimeGroupId(stripId).push_back(-1);               // orphan
-
-            // std::cout << "     leftover cluster " << " stripTime " << stripTime
-            //           << " GroupId " << m_inoEvent->getTimeGroupId(stripId).back() << std::endl;
-
-          }
-        }
+void INOTimeGroupingModule::assignGroupIdsToTimes(const StripId& stripId, const double* stripTimes, int nTimes,
+                                                  double tRangeLow, double tRangeHigh,
+                                                  const std::vector<GroupInfo>& groupInfoVector)
+{
+  int nGroups = groupInfoVector.size();
+  int lastGroup = nGroups - 1;
+  int nWords = (nGroups + 63) / 64;
+  int nEdges = m_acceptanceEdges.size();
+  auto isAccepted = [&](int cell, int group) {
+    return (m_cellGroupMasks[cell * nWords + (group >> 6)] >> (group & 63)) & 1;
+  };
+
+  m_timeCells.resize(nTimes);
+  for (int it = 0; it < nTimes; it++) {
+    int edge = std::lower_bound(m_acceptanceEdges.begin(), m_acceptanceEdges.end(), stripTimes[it])
+               - m_acceptanceEdges.begin();
+    bool isOnEdge = edge < nEdges && m_acceptanceEdges[edge] == stripTimes[it];
+    m_timeCells[it] = isOnEdge ? 2 * edge + 1 : 2 * edge;
+  }
+
+  // groupIds in increasing order, for each group the times in their order
+  for (int word = 0; word < nWords; word++) {
+    uint64_t groups = 0;
+    for (int it = 0; it < nTimes; it++)
+      groups |= m_cellGroupMasks[m_timeCells[it] * nWords + word];
+    while (groups) {
+      int ij = word * 64 + __builtin_ctzll(groups);
+      groups &= groups - 1;
+      if (ij == lastGroup) continue; // handled with the leftover clusters below
+      for (int it = 0; it < nTimes; it++) {
+        if (!isAccepted(m_timeCells[it], ij)) continue;
+
+        // assigning groupId starting from 0
+        m_inoEvent->setTimeGroupId(stripId).push_back(ij);
+
+        // writing group info to clusters.
+        // this is independent of group id, that means,
+        if (m_usedPars.writeGroupInfo)
+          m_inoEvent->setTimeGroupInfo(stripId).push_back(groupInfoVector[ij]);
       }
-    } // end of loop over all clusters
-  }   // end of loop over groups
+    }
+  }
+
+  // the last group, the leftover clusters get their groupId here
+  for (int it = 0; it < nTimes; it++) {
+    double stripTime = stripTimes[it];
+
+    if (isAccepted(m_timeCells[it], lastGroup)) {
+
+      m_inoEvent->setTimeGroupId(stripId).push_back(lastGroup);
+      if (m_usedPars.writeGroupInfo)
+        m_inoEvent->setTimeGroupInfo(stripId).push_back(groupInfoVector[lastGroup]);
 
+    } else if (int(m_inoEvent->getTimeGroupId(stripId).size()) == 0) { // leftover clusters
+
+      if (m_usedPars.includeOutOfRangeClusters && stripTime < tRangeLow)
+        m_inoEvent->setTimeGroupId(stripId).push_back(m_usedPars.maxGroups + 1);  // underflow
+      else if (m_usedPars.includeOutOfRangeClusters && stripTime > tRangeHigh)
+        m_inoEvent->setTimeGroupId(stripId).push_back(m_usedPars.maxGroups + 2);  // overflow
+      else
+        m_inoEvent->setTimeGroupId(stripId).push_back(-1);               // orphan
+
+      // std::cout << "     leftover cluster " << " stripTime " << stripTime
+      //           << " GroupId " << m_inoEvent->getTimeGroupId(stripId).back() << std::endl;
+    }
+  }
 }
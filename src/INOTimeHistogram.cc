@@ -0,0 +1,51 @@
+#include "INOTimeHistogram.h"
+
+#include <algorithm>
+#include <cfloat>
+
+using namespace INO;
+
+void INOTimeHistogram::reset(int nBins, double low, double high) {
+  // clear what was filled with the previous binning
+  int nBlocks = int(m_touchedBlocks.size()) * 64;
+  for (int block = 0; block < nBlocks; block++)
+    if (isTouched(block)) {
+      auto first = m_contents.begin() + (block << c_blockShift);
+      auto last  = m_contents.begin() + std::min(int(m_contents.size()), (block + 1) << c_blockShift);
+      std::fill(first, last, 0.);
+    }
+  std::fill(m_touchedBlocks.begin(), m_touchedBlocks.end(), 0);
+
+  m_nBins = nBins;
+  m_low = low;
+  m_high = high;
+  m_binWidth = (high - low) / double(nBins);
+  if (int(m_contents.size()) < nBins) {
+    m_contents.resize(nBins, 0.);
+    m_touchedBlocks.resize((((nBins - 1) >> c_blockShift) >> 6) + 1, 0);
+  }
+}
+
+int INOTimeHistogram::getMaximumBin() const {
+  // untouched bins are empty, the first of them stands for all
+  int firstEmptyBin = 0;
+  double maxContent = -FLT_MAX;
+  int maxBin = 1;
+  int nBlocks = ((m_nBins - 1) >> c_blockShift) + 1;
+  for (int block = 0; block < nBlocks; block++) {
+    int firstBin = (block << c_blockShift) + 1;
+    if (!isTouched(block)) {
+      if (!firstEmptyBin) firstEmptyBin = firstBin;
+      continue;
+    }
+    int lastBin = std::min(m_nBins, (block + 1) << c_blockShift);
+    for (int bin = firstBin; bin <= lastBin; bin++)
+      if (m_contents[bin - 1] > maxContent) {
+        maxContent = m_contents[bin - 1];
+        maxBin = bin;
+      }
+  }
+  if (firstEmptyBin && (maxContent < 0 || (maxContent == 0 && firstEmptyBin < maxBin)))
+    return firstEmptyBin;
+  return maxBin;
+}
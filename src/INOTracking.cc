@@ -0,0 +1,590 @@
+
+#include "INOTracking.h"
+#include "INOInstrumentation.h"
+#include "INOHitDecoder.h"
+
+#include <map>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <memory>
+
+namespace INO {
+
+  namespace {
+    const double cval_mps = 0.29979e9; /* light speed in m/s */
+  }
+
+  void fitLine(bool isTime, const LineFitPoints& points, LineFitResult& fit) {
+
+    double szxy[nSides] = {0};
+    double   sz[nSides] = {0};
+    double  sxy[nSides] = {0};
+    double   sn[nSides] = {0};
+    double  sz2[nSides] = {0};
+
+    for (int ij = 0; ij < points.n; ij++) {
+      if (points.isUsed && !points.isUsed[ij]) continue;
+      double z = points.z[ij];
+      for (int nj = 0; nj < nSides; nj++) {
+        double value = points.value[nj][ij];
+        double variance = points.variance[nj][ij];
+        szxy[nj] += z*value/variance;
+        sz[nj]   += z/variance;
+        sz2[nj]  += z*z/variance;
+        sxy[nj]  += value/variance;
+        sn[nj]   += 1/variance;
+      }
+    }
+
+    for (int nj = 0; nj < nSides; nj++) {
+      fit.slope[nj] = fit.inter[nj] = -10000;
+      fit.errcst[nj] = fit.errcov[nj] = fit.errlin[nj] = -10000;
+      double determ = sz2[nj]*sn[nj] - sz[nj]*sz[nj];
+      if (sn[nj] > 0. && determ != 0.) {
+        fit.slope[nj] = isTime ? -1./cval_mps : (szxy[nj]*sn[nj] - sz[nj]*sxy[nj])/determ;
+        fit.inter[nj] = sxy[nj]/sn[nj] - fit.slope[nj]*sz[nj]/sn[nj];
+        determ = sn[nj]*sz2[nj] - sz[nj]*sz[nj];
+        fit.errcst[nj] = sz2[nj]/determ;
+        fit.errcov[nj] = -sz[nj]/determ;
+        fit.errlin[nj] = sn[nj]/determ;
+      }
+      fit.chi2[nj] = 0;
+    }
+
+    for (int ij = 0; ij < points.n; ij++) {
+      if (points.isUsed && !points.isUsed[ij]) continue;
+      for (int nj = 0; nj < nSides; nj++) {
+        double residual = fit.getValue(nj, points.z[ij]) - points.value[nj][ij];
+        fit.chi2[nj] += residual*residual/points.variance[nj][ij];
+      }
+    }
+  }
+
+
+  void LineFitBuffer::clear() {
+    z.clear();
+    for (int nj = 0; nj < nSides; nj++) {
+      value[nj].clear();
+      variance[nj].clear();
+    }
+  }
+
+  void LineFitBuffer::add(const TVector3& position, double varianceX, double varianceY) {
+    z.push_back(position.Z());
+    value[0].push_back(position.X());
+    value[1].push_back(position.Y());
+    variance[0].push_back(varianceX);
+    variance[1].push_back(varianceY);
+  }
+
+  LineFitPoints LineFitBuffer::getPoints() const {
+    LineFitPoints points;
+    points.n = z.size();
+    points.z = z.data();
+    for (int nj = 0; nj < nSides; nj++) {
+      points.value[nj] = value[nj].data();
+      points.variance[nj] = variance[nj].data();
+    }
+    return points;
+  }
+
+
+  void LineFitBatch::reset() {
+    for (int ij = 0; ij < nPoints; ij++)
+      for (int it = 0; it < width; it++) {
+        z[ij][it] = 0;
+        for (int nj = 0; nj < nSides; nj++) {
+          value[nj][ij][it] = 0;
+          variance[nj][ij][it] = std::numeric_limits<double>::infinity();
+        }
+      }
+  }
+
+  void LineFitBatch::setPoint(int track, int point, const TVector3& position, double varianceX, double varianceY) {
+    z[point][track] = position.Z();
+    value[0][point][track] = position.X();
+    value[1][point][track] = position.Y();
+    variance[0][point][track] = varianceX;
+    variance[1][point][track] = varianceY;
+  }
+
+
+  void fitLines(bool isTime, LineFitBatch& batch) {
+    const int width = LineFitBatch::width;
+
+    for (int nj = 0; nj < nSides; nj++) {
+      double szxy[width] = {0};
+      double   sz[width] = {0};
+      double  sxy[width] = {0};
+      double   sn[width] = {0};
+      double  sz2[width] = {0};
+
+      // the same sums as fitLine, point by point, each track in its own lane
+      for (int ij = 0; ij < LineFitBatch::nPoints; ij++) {
+        const double* z = batch.z[ij];
+        const double* value = batch.value[nj][ij];
+        const double* variance = batch.variance[nj][ij];
+#pragma omp simd
+        for (int it = 0; it < width; it++) {
+          szxy[it] += z[it]*value[it]/variance[it];
+          sz[it]   += z[it]/variance[it];
+          sz2[it]  += z[it]*z[it]/variance[it];
+          sxy[it]  += value[it]/variance[it];
+          sn[it]   += 1/variance[it];
+        }
+      }
+
+      // every lane divides and the unfitted ones are replaced at the end, a
+      // select in the same loop would let the compiler branch around the division
+      double determ[width], fitSlope[width], fitInter[width];
+#pragma omp simd
+      for (int it = 0; it < width; it++) {
+        determ[it] = sz2[it]*sn[it] - sz[it]*sz[it];
+        fitSlope[it] = (szxy[it]*sn[it] - sz[it]*sxy[it])/determ[it];
+      }
+      if (isTime)
+        for (int it = 0; it < width; it++) fitSlope[it] = -1./cval_mps;
+      double errcst[width], errcov[width], errlin[width];
+#pragma omp simd
+      for (int it = 0; it < width; it++) {
+        fitInter[it] = sxy[it]/sn[it] - fitSlope[it]*sz[it]/sn[it];
+        errcst[it] = sz2[it]/determ[it];
+        errcov[it] = -sz[it]/determ[it];
+        errlin[it] = sn[it]/determ[it];
+      }
+
+      double* slope = batch.slope[nj];
+      double* inter = batch.inter[nj];
+#pragma omp simd
+      for (int it = 0; it < width; it++) {
+        bool isFitted = (sn[it] > 0.) & (determ[it] != 0.);
+        slope[it] = isFitted ? fitSlope[it] : -10000;
+        inter[it] = isFitted ? fitInter[it] : -10000;
+        batch.errcst[nj][it] = isFitted ? errcst[it] : -10000;
+        batch.errcov[nj][it] = isFitted ? errcov[it] : -10000;
+        batch.errlin[nj][it] = isFitted ? errlin[it] : -10000;
+      }
+
+      double* chi2 = batch.chi2[nj];
+      for (int it = 0; it < width; it++) chi2[it] = 0;
+      for (int ij = 0; ij < LineFitBatch::nPoints; ij++) {
+        const double* z = batch.z[ij];
+        const double* value = batch.value[nj][ij];
+        const double* variance = batch.variance[nj][ij];
+#pragma omp simd
+        for (int it = 0; it < width; it++) {
+          double residual = slope[it]*z[it] + inter[it] - value[it];
+          chi2[it] += residual*residual/variance[it];
+        }
+      }
+    }
+  }
+
+
+  void LinearVectorFit(bool                   isTime,
+                       std::vector<TVector3>  pos,
+                       std::vector<TVector2>  poserr,
+                       std::vector<bool>      occulay,
+                       TVector2              &slope,
+                       TVector2              &inter,
+                       TVector2              &chi2,
+                       std::vector<TVector3> &ext,
+                       std::vector<TVector3> &exterr) {
+    LineFitBuffer buffer;
+    for (int ij = 0; ij < int(pos.size()); ij++)
+      buffer.add(pos[ij], poserr[ij].X(), poserr[ij].Y());
+    std::unique_ptr<bool[]> isUsed;
+    LineFitPoints points = buffer.getPoints();
+    if (int(occulay.size())) {
+      isUsed.reset(new bool[pos.size()]);
+      for (int ij = 0; ij < int(pos.size()); ij++) isUsed[ij] = occulay[ij];
+      points.isUsed = isUsed.get();
+    }
+
+    LineFitResult fit;
+    fitLine(isTime, points, fit);
+    slope.Set(fit.slope[0], fit.slope[1]);
+    inter.Set(fit.inter[0], fit.inter[1]);
+    chi2.Set(fit.chi2[0], fit.chi2[1]);
+    ext.clear(); exterr.clear();
+    for (int ij = 0; ij < int(pos.size()); ij++) {
+      double z = pos[ij].Z();
+      ext.emplace_back(fit.getValue(0, z), fit.getValue(1, z), z);
+      exterr.emplace_back(fit.getVariance(0, z), fit.getVariance(1, z), 0.);
+    }
+  }
+
+
+  bool formPixels(const INOEvent& inoEvent, std::vector<PixelId>& allPixels) {
+    INO_SCOPED_TIMER("track/pixels");
+    std::map<SideId, std::vector<StripId>> stripHits;
+    for (const auto& hit : inoEvent.getHitRange()) {
+      StripId stripId = hit.stripId;
+      if(!int(inoEvent.getCalibratedLeadingTimes(stripId).size())) continue;
+      const auto& groupIds = inoEvent.getTimeGroupId(stripId);
+      if (std::find(groupIds.begin(), groupIds.end(), 0) == groupIds.end()) continue; // only group 0
+      stripHits[{hit.stripId.module,
+            hit.stripId.row,
+            hit.stripId.column,
+            hit.stripId.layer,
+            hit.stripId.side}].push_back(hit.stripId);
+    }
+    if (int(stripHits.size()) < 10) return false;
+    for (auto stripHit : stripHits) {
+      if (int(stripHit.second.size()) > 5) continue;
+      auto sideId = stripHit.first;
+      auto it = stripHits.find({sideId.module,
+                                sideId.row,
+                                sideId.column,
+                                sideId.layer,
+                                !sideId.side});
+      if (it != stripHits.end())
+        for (auto strip1 : stripHit.second)
+          for (auto strip2 : it->second)
+            allPixels.push_back({sideId.module,
+                                 sideId.row,
+                                 sideId.column,
+                                 sideId.layer,
+                                 {sideId.side ? strip2.strip : strip1.strip,
+                                  sideId.side ? strip1.strip : strip2.strip} });
+    }
+    return true;
+  }
+
+
+  namespace {
+
+    /** Distinct pixels of each layer of an event and their positions, for findTrack */
+    struct LayerPixels {
+      int n[nLayers];
+      PixelId pixel[nLayers][maxTrackLayerPixels];
+      double position[nLayers][maxTrackLayerPixels][3];  /**< x, y and z */
+    };
+
+    /**
+     * Pixel of layer nearest to the line at (x, y, z) = point + slope * dz
+     * with both coordinates within road, -1 if there is none.
+     */
+    int findNearestPixel(const LayerPixels& layerPixels, int layer, const double point[3],
+                         const double slope[nSides], double road, double& distance2) {
+      int nearest = -1;
+      for (int ij = 0; ij < layerPixels.n[layer]; ij++) {
+        const double* position = layerPixels.position[layer][ij];
+        double dz = position[2] - point[2];
+        double dx = position[0] - (point[0] + slope[0] * dz);
+        double dy = position[1] - (point[1] + slope[1] * dz);
+        if (std::fabs(dx) > road || std::fabs(dy) > road) continue;
+        if (nearest < 0 || dx * dx + dy * dy < distance2) {
+          nearest = ij;
+          distance2 = dx * dx + dy * dy;
+        }
+      }
+      return nearest;
+    }
+
+    /**
+     * Nearest pixel of every layer to a line, the number of layers with one
+     * and the sum of squared distances; gives up, with a smaller number, as
+     * soon as fewer than minFound layers can be reached.
+     */
+    int collectTrack(const LayerPixels& layerPixels, const double point[3], const double slope[nSides],
+                     double road, int minFound, int chosen[nLayers], double& sumDistance2) {
+      int nLayersFound = 0;
+      sumDistance2 = 0;
+      for (int layer = 0; layer < nLayers; layer++) {
+        if (nLayersFound + nLayers - layer < minFound) return nLayersFound;
+        double distance2 = 0;
+        chosen[layer] = findNearestPixel(layerPixels, layer, point, slope, road, distance2);
+        if (chosen[layer] < 0) continue;
+        nLayersFound++;
+        sumDistance2 += distance2;
+      }
+      return nLayersFound;
+    }
+
+  } // namespace
+
+
+  bool findTrack(const std::vector<PixelId>& pixels, const INOPixelGeometry& pixelGeometry,
+                 const TrackFindingParameters& pars, std::vector<PixelId>& trackPixels) {
+    INO_SCOPED_TIMER("track/find");
+    trackPixels.clear();
+
+    // each pixel once, formPixels lists them from both sides
+    LayerPixels layerPixels;
+    for (int layer = 0; layer < nLayers; layer++) layerPixels.n[layer] = 0;
+    bool isCrowded[nLayers] = {};
+    for (const auto& pixel : pixels) {
+      if (pixel.layer < 0 || pixel.layer >= nLayers || isCrowded[pixel.layer]) continue;
+      int& n = layerPixels.n[pixel.layer];
+      bool isListed = false;
+      for (int ij = 0; ij < n && !isListed; ij++)
+        isListed = layerPixels.pixel[pixel.layer][ij].strip[0] == pixel.strip[0] &&
+          layerPixels.pixel[pixel.layer][ij].strip[1] == pixel.strip[1];
+      if (isListed) continue;
+      if (n == maxTrackLayerPixels) {
+        isCrowded[pixel.layer] = true;
+        continue;
+      }
+      layerPixels.pixel[pixel.layer][n] = pixel;
+      TVector3 position = pixelGeometry.getPosition(pixel);
+      for (int kl = 0; kl < 3; kl++) layerPixels.position[pixel.layer][n][kl] = position[kl];
+      n++;
+    }
+    for (int layer = 0; layer < nLayers; layer++)
+      if (isCrowded[layer]) layerPixels.n[layer] = 0;
+
+    // the seed layers, in each half of the stack the two with the fewest pixels, the outer one of equals first
+    int seedLayers[2][2];
+    int nSeedLayers[2] = {0, 0};
+    for (int half = 0; half < 2; half++)
+      for (int ij = 0; ij < nLayers / 2; ij++) {
+        int layer = half ? nLayers - 1 - ij : ij;
+        int n = layerPixels.n[layer];
+        if (n == 0) continue;
+        int* seeds = seedLayers[half];
+        int& nSeeds = nSeedLayers[half];
+        if (nSeeds < 2) seeds[nSeeds++] = layer;
+        else if (n < layerPixels.n[seeds[1]]) seeds[1] = layer;
+        if (nSeeds == 2 && layerPixels.n[seeds[1]] < layerPixels.n[seeds[0]]) std::swap(seeds[0], seeds[1]);
+      }
+
+    // the line through every pair of seed pixels, the pairs of the layers with too many are not tried
+    int best[nLayers];
+    std::fill(best, best + nLayers, -1);
+    int nBestLayers = 0;
+    double bestDistance2 = 0;
+    for (int kl = 0; kl < nSeedLayers[0]; kl++)
+      for (int lm = 0; lm < nSeedLayers[1]; lm++) {
+        int top = seedLayers[0][kl], bottom = seedLayers[1][lm];
+        if (layerPixels.n[top] * layerPixels.n[bottom] > pars.maxSeedPairs) continue;
+        for (int ij = 0; ij < layerPixels.n[top]; ij++)
+          for (int jk = 0; jk < layerPixels.n[bottom]; jk++) {
+            const double* point = layerPixels.position[top][ij];
+            const double* second = layerPixels.position[bottom][jk];
+            double slope[nSides];
+            for (int nj = 0; nj < nSides; nj++) slope[nj] = (second[nj] - point[nj]) / (second[2] - point[2]);
+            int chosen[nLayers];
+            double sumDistance2;
+            int nFound = collectTrack(layerPixels, point, slope, pars.road, nBestLayers, chosen, sumDistance2);
+            if (nFound > nBestLayers || (nFound == nBestLayers && sumDistance2 < bestDistance2)) {
+              nBestLayers = nFound;
+              bestDistance2 = sumDistance2;
+              std::copy(chosen, chosen + nLayers, best);
+            }
+          }
+      }
+    if (nBestLayers == 0 || nBestLayers < pars.minLayers) return false;
+
+    // fit of the best candidate, and its pixels again around the fit
+    double z[nLayers], value[nSides][nLayers], variance[nLayers];
+    LineFitPoints points;
+    for (int layer = 0; layer < nLayers; layer++) {
+      if (best[layer] < 0) continue;
+      const double* position = layerPixels.position[layer][best[layer]];
+      z[points.n] = position[2];
+      value[0][points.n] = position[0];
+      value[1][points.n] = position[1];
+      variance[points.n] = 0.008;
+      points.n++;
+    }
+    points.z = z;
+    for (int nj = 0; nj < nSides; nj++) {
+      points.value[nj] = value[nj];
+      points.variance[nj] = variance;
+    }
+    LineFitResult fit;
+    fitLine(0, points, fit);
+    double point[3] = {fit.inter[0], fit.inter[1], 0.};
+    double sumDistance2;
+    int chosen[nLayers];
+    if (collectTrack(layerPixels, point, fit.slope, pars.road, nBestLayers, chosen, sumDistance2) >= nBestLayers)
+      std::copy(chosen, chosen + nLayers, best);
+
+    for (int layer = 0; layer < nLayers; layer++)
+      if (best[layer] >= 0) trackPixels.push_back(layerPixels.pixel[layer][best[layer]]);
+    return true;
+  }
+
+
+  void LinearFitSums::add(int side, double z, double value, double variance) {
+    double weight = 1. / variance;
+    m_szxy[side] += z * value * weight;
+    m_sz[side] += z * weight;
+    m_sz2[side] += z * z * weight;
+    m_sxy[side] += value * weight;
+    m_sn[side] += weight;
+    m_nPoints[side]++;
+  }
+
+  void LinearFitSums::remove(int side, double z, double value, double variance) {
+    double weight = 1. / variance;
+    m_szxy[side] -= z * value * weight;
+    m_sz[side] -= z * weight;
+    m_sz2[side] -= z * z * weight;
+    m_sxy[side] -= value * weight;
+    m_sn[side] -= weight;
+    m_nPoints[side]--;
+  }
+
+  bool LinearFitSums::getLine(int side, double& slope, double& inter) const {
+    // removing points leaves rounding in the sums, so points at one z do not give a zero determinant
+    double determ = m_sz2[side] * m_sn[side] - m_sz[side] * m_sz[side];
+    if (m_nPoints[side] < 2 || !(determ > 1.e-9 * m_sz2[side] * m_sn[side])) return false;
+    slope = (m_szxy[side] * m_sn[side] - m_sz[side] * m_sxy[side]) / determ;
+    inter = m_sxy[side] / m_sn[side] - slope * m_sz[side] / m_sn[side];
+    return true;
+  }
+
+  bool LinearFitSums::extrapolate(int side, double z, double& value, double& variance) const {
+    double slope, inter;
+    if (!getLine(side, slope, inter)) return false;
+    double determ = m_sn[side] * m_sz2[side] - m_sz[side] * m_sz[side];
+    value = slope * z + inter;
+    variance = (m_sz2[side] - 2 * m_sz[side] * z + m_sn[side] * z * z) / determ;
+    return true;
+  }
+
+
+  namespace {
+
+    const double clusterVariance = 0.008; // variance of a cluster centre in the fit
+
+    /** Group 0 strips of every layer side of a stack and the cluster centres of the track fit */
+    struct StackHits {
+      uint64_t strips[nLayers][nSides];
+      bool isUsed[nLayers][nSides];  /**< strips of the side are one small cluster */
+      double position[nLayers][nSides];
+      double z[nLayers];
+    };
+
+    void collectStackHits(const INOEvent& inoEvent, const INOPixelGeometry& pixelGeometry,
+                          const LayerId& stackId, const EfficiencyParameters& pars, StackHits& hits) {
+      for (int layer = 0; layer < nLayers; layer++)
+        for (int nj = 0; nj < nSides; nj++) hits.strips[layer][nj] = 0;
+      for (const auto& hit : inoEvent.getHitRange()) {
+        const StripId& stripId = hit.stripId;
+        if (stripId.module != stackId.module || stripId.row != stackId.row || stripId.column != stackId.column) continue;
+        const auto& groupIds = inoEvent.getTimeGroupId(stripId);
+        if (std::find(groupIds.begin(), groupIds.end(), 0) == groupIds.end()) continue; // only group 0
+        hits.strips[stripId.layer][stripId.side] |= uint64_t(1) << stripId.strip;
+      }
+
+      for (int layer = 0; layer < nLayers; layer++) {
+        double centre[nSides];
+        for (int nj = 0; nj < nSides; nj++) {
+          uint64_t bits = hits.strips[layer][nj];
+          int first = bits ? __builtin_ctzll(bits) : 0;
+          int last = bits ? 63 - __builtin_clzll(bits) : 0;
+          hits.isUsed[layer][nj] = bits && last - first < pars.maxClusterStrips &&
+            __builtin_popcountll(bits) == last - first + 1;
+          centre[nj] = hits.isUsed[layer][nj] ? 0.5 * (first + last) : 0.5 * (nStrips - 1);
+        }
+        // position of the pixel below the centre, moved by the fraction of a strip
+        TVector3 point = pixelGeometry.getPosition({stackId.module, stackId.row, stackId.column, layer,
+                                                    {int(centre[0]), int(centre[1])}});
+        for (int nj = 0; nj < nSides; nj++)
+          hits.position[layer][nj] = point[nj] + (centre[nj] - int(centre[nj])) * pixelGeometry.getStripWidth();
+        hits.z[layer] = point.Z();
+      }
+    }
+
+    /**
+     * Test layer with allSums, the sums of the used sides of all layers of
+     * hits; the layer and the sides outside the road are taken out of a copy.
+     */
+    bool testLayer(const StackHits& hits, const LinearFitSums& allSums, const INOPixelGeometry& pixelGeometry,
+                   const LayerId& layerId, const EfficiencyParameters& pars, EfficiencyProbe& probe) {
+      LinearFitSums sums = allSums;
+      bool isUsed[nLayers][nSides];
+      for (int layer = 0; layer < nLayers; layer++)
+        for (int nj = 0; nj < nSides; nj++) {
+          isUsed[layer][nj] = hits.isUsed[layer][nj] && layer != layerId.layer;
+          if (hits.isUsed[layer][nj] && layer == layerId.layer)
+            sums.remove(nj, hits.z[layer], hits.position[layer][nj], clusterVariance);
+        }
+
+      // drop the side furthest from the track while it is outside the road
+      double slope[nSides], inter[nSides];
+      while (true) {
+        for (int nj = 0; nj < nSides; nj++)
+          if (sums.getNPoints(nj) < pars.minFitLayers || !sums.getLine(nj, slope[nj], inter[nj])) return false;
+        int worst = -1, worstSide = 0;
+        double worstDistance = pars.road;
+        for (int layer = 0; layer < nLayers; layer++)
+          for (int nj = 0; nj < nSides; nj++) {
+            if (!isUsed[layer][nj]) continue;
+            double distance = std::fabs(slope[nj] * hits.z[layer] + inter[nj] - hits.position[layer][nj]);
+            if (distance > worstDistance) {
+              worst = layer;
+              worstSide = nj;
+              worstDistance = distance;
+            }
+          }
+        if (worst < 0) break;
+        sums.remove(worstSide, hits.z[worst], hits.position[worst][worstSide], clusterVariance);
+        isUsed[worst][worstSide] = false;
+      }
+
+      // strips under the track, at the z of the centre of strip 0
+      PixelId cell = {layerId.module, layerId.row, layerId.column, layerId.layer, {0, 0}};
+      TVector3 origin = pixelGeometry.getPosition(cell);
+      double track[nSides];
+      for (int nj = 0; nj < nSides; nj++) track[nj] = slope[nj] * origin.Z() + inter[nj];
+      if (!pixelGeometry.findPixel(layerId, track[0], track[1], cell)) return false;
+      probe.cell = cell;
+
+      for (int nj = 0; nj < nSides; nj++) {
+        probe.residual[nj] = std::numeric_limits<double>::quiet_NaN();
+        forEachSetBit(hits.strips[layerId.layer][nj], [&](int strip) {
+          PixelId pixel = cell;
+          pixel.strip[nj] = strip;
+          double residual = pixelGeometry.getPosition(pixel)[nj] - track[nj];
+          if (!(std::fabs(residual) >= std::fabs(probe.residual[nj]))) probe.residual[nj] = residual;
+        });
+        probe.passed[nj] = std::fabs(probe.residual[nj]) <= pars.road;
+      }
+      return true;
+    }
+
+    LinearFitSums sumStackHits(const StackHits& hits) {
+      LinearFitSums sums;
+      for (int layer = 0; layer < nLayers; layer++)
+        for (int nj = 0; nj < nSides; nj++)
+          if (hits.isUsed[layer][nj]) sums.add(nj, hits.z[layer], hits.position[layer][nj], clusterVariance);
+      return sums;
+    }
+
+  } // namespace
+
+
+  bool probeLayer(const INOEvent& inoEvent, const INOPixelGeometry& pixelGeometry,
+                  const LayerId& layerId, const EfficiencyParameters& pars, EfficiencyProbe& probe) {
+    INO_SCOPED_TIMER("track/probe");
+    StackHits hits;
+    collectStackHits(inoEvent, pixelGeometry, layerId, pars, hits);
+    return testLayer(hits, sumStackHits(hits), pixelGeometry, layerId, pars, probe);
+  }
+
+
+  int probeLayers(const INOEvent& inoEvent, const INOPixelGeometry& pixelGeometry,
+                  const LayerId& stackId, const EfficiencyParameters& pars,
+                  std::vector<EfficiencyProbe>& probes) {
+    INO_SCOPED_TIMER("track/probe");
+    StackHits hits;
+    collectStackHits(inoEvent, pixelGeometry, stackId, pars, hits);
+    LinearFitSums sums = sumStackHits(hits);
+    int nProbes = 0;
+    for (int layer = 0; layer < nLayers; layer++) {
+      if (!((pars.testLayerMask >> layer) & 1)) continue;
+      EfficiencyProbe probe;
+      if (!testLayer(hits, sums, pixelGeometry, {stackId.module, stackId.row, stackId.column, layer}, pars, probe))
+        continue;
+      probes.push_back(probe);
+      nProbes++;
+    }
+    return nProbes;
+  }
+
+} // namespace INO
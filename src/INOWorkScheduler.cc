@@ -0,0 +1,107 @@
+
+#include "INOWorkScheduler.h"
+
+#include <algorithm>
+
+namespace INO {
+
+  INOWorkScheduler::INOWorkScheduler(const std::vector<WorkChunk>& ranges, int nWorkers,
+                                     int64_t minChunk, int64_t maxChunk) :
+    m_minChunk(std::max<int64_t>(1, minChunk)), m_maxChunk(std::max(m_minChunk, maxChunk)), m_nSteals(0) {
+    if (nWorkers < 1) nWorkers = 1;
+    for (int ij = 0; ij < nWorkers; ij++) m_queues.emplace_back(new Queue);
+
+    int64_t nEntries = 0;
+    for (const auto& range : ranges)
+      if (range.last >= range.first) nEntries += range.last - range.first + 1;
+
+    // worker ij gets the entries [ij, ij + 1) * nEntries / nWorkers of the concatenated ranges
+    int worker = 0;
+    int64_t offset = 0;
+    for (const auto& range : ranges) {
+      int64_t first = range.first;
+      while (first <= range.last) {
+        int64_t shareEnd = (worker + 1) * nEntries / nWorkers;
+        int64_t last = std::min(range.last, first + (shareEnd - offset) - 1);
+        if (last >= first) {
+          m_queues[worker]->ranges.push_back({range.fileIndex, first, last});
+          m_queues[worker]->nEntries += last - first + 1;
+          offset += last - first + 1;
+          first = last + 1;
+        }
+        if (offset == shareEnd && worker < nWorkers - 1) worker++;
+      }
+    }
+  }
+
+  bool INOWorkScheduler::next(int worker, WorkChunk& chunk) {
+    Queue& queue = *m_queues[worker];
+    while (true) {
+      {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.ranges.empty()) {
+          WorkChunk& front = queue.ranges.front();
+          int64_t size = std::max(m_minChunk, std::min(m_maxChunk, int64_t(queue.nEntries) / 4));
+          chunk = {front.fileIndex, front.first, std::min(front.last, front.first + size - 1)};
+          front.first = chunk.last + 1;
+          if (front.first > front.last) queue.ranges.pop_front();
+          queue.nEntries -= chunk.last - chunk.first + 1;
+          return true;
+        }
+      }
+      // nothing is added after the start, no other share left means all is handed out
+      if (!steal(worker)) return false;
+    }
+  }
+
+  bool INOWorkScheduler::steal(int worker) {
+    int nWorkers = m_queues.size();
+    while (true) {
+      int victim = -1;
+      int64_t nVictimEntries = 0;
+      for (int ij = 1; ij < nWorkers; ij++) {
+        int other = (worker + ij) % nWorkers;
+        int64_t nEntries = m_queues[other]->nEntries;
+        if (nEntries > nVictimEntries) {
+          victim = other;
+          nVictimEntries = nEntries;
+        }
+      }
+      if (victim < 0) return false;
+
+      // take the back half of the victim's share, the victim keeps working at the front
+      std::deque<WorkChunk> stolen;
+      int64_t nStolen = 0;
+      {
+        Queue& queue = *m_queues[victim];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        int64_t nWanted = (queue.nEntries + 1) / 2;
+        while (nStolen < nWanted && !queue.ranges.empty()) {
+          WorkChunk& back = queue.ranges.back();
+          int64_t nRange = back.last - back.first + 1;
+          if (nRange <= nWanted - nStolen) {
+            stolen.push_front(back);
+            queue.ranges.pop_back();
+            nStolen += nRange;
+          } else {
+            int64_t first = back.last - (nWanted - nStolen) + 1;
+            stolen.push_front({back.fileIndex, first, back.last});
+            back.last = first - 1;
+            nStolen = nWanted;
+          }
+        }
+        queue.nEntries -= nStolen;
+      }
+      // the victim finished in the meantime, look for another one
+      if (!nStolen) continue;
+
+      Queue& queue = *m_queues[worker];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      queue.ranges.insert(queue.ranges.end(), stolen.begin(), stolen.end());
+      queue.nEntries += nStolen;
+      m_nSteals++;
+      return true;
+    }
+  }
+
+} // namespace INO
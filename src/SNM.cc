@@ -41,3 +41,77 @@ void SNM::Loop()
    //    // if (Cut(ientry) < 0) continue;
    // }
 }
+
+
+void SNM::SetActiveLayers(UInt_t layerMask)
+{
+  // Only the layers with their bit set in layerMask are read, the branches
+  // of the other layers are disabled and their hit counts are zero.
+  if (fChain == 0) return;
+
+  const char *sideMark[2] = {"x","y"};
+
+  fActiveLayers = layerMask & 0xFFF;
+  for(int nj=0;nj<2;nj++) {
+    for(int ij=0;ij<12;ij++) {
+      Bool_t isActive = (fActiveLayers>>ij)&0x01;
+      for(int jk=0;jk<8;jk++) {
+        fChain->SetBranchStatus(TString::Format("xythit_%s_l%i_%i",sideMark[nj],ij,jk),isActive);
+        fChain->SetBranchStatus(TString::Format("xytime_%s_l%i_%i",sideMark[nj],ij,jk),isActive);
+        fChain->SetBranchStatus(TString::Format("plWidth_%s_l%i_%i",sideMark[nj],ij,jk),isActive);
+        if (!isActive) xythit[nj][ij][jk] = 0;
+      }
+    }
+  }
+}
+
+Int_t SNM::GetHeaderEntry(Long64_t entry)
+{
+  // Read nevt, evetime, xydata and the hit counts of the active layers.
+  // Returns the number of bytes read, like GetEntry.
+  Long64_t ientry = LoadTree(entry);
+  if (ientry < 0) return 0;
+  fStagedEntry = ientry;
+
+  Int_t nbytes = 0;
+  nbytes += b_nevt->GetEntry(ientry);
+  nbytes += b_evetime->GetEntry(ientry);
+  nbytes += b_xydata->GetEntry(ientry);
+  for(int nj=0;nj<2;nj++)
+    for(int ij=0;ij<12;ij++) {
+      if (!((fActiveLayers>>ij)&0x01)) continue;
+      for(int jk=0;jk<8;jk++)
+        nbytes += b_xythit[nj][ij][jk]->GetEntry(ientry);
+    }
+  return nbytes;
+}
+
+Int_t SNM::GetTDCEntry()
+{
+  // Read xytime and plWidth of the entry of the last GetHeaderEntry, only
+  // for the channels with hits. The arrays of the other channels keep
+  // stale values and must not be used.
+  if (fStagedEntry < 0) return 0;
+
+  Int_t nbytes = 0;
+  for(int nj=0;nj<2;nj++)
+    for(int ij=0;ij<12;ij++) {
+      if (!((fActiveLayers>>ij)&0x01)) continue;
+      for(int jk=0;jk<8;jk++) {
+        if (!xythit[nj][ij][jk]) continue;
+        nbytes += b_xytime[nj][ij][jk]->GetEntry(fStagedEntry);
+        nbytes += b_plWidth[nj][ij][jk]->GetEntry(fStagedEntry);
+      }
+    }
+  return nbytes;
+}
+
+Bool_t SNM::GetStagedEntry(Long64_t entry, const std::function<Bool_t(const SNM&)>& prefilter)
+{
+  // Read the header of entry, and its TDC data if prefilter accepts it.
+  // Returns kFALSE if the entry could not be read or was rejected.
+  if (GetHeaderEntry(entry) <= 0) return kFALSE;
+  if (prefilter && !prefilter(*this)) return kFALSE;
+  GetTDCEntry();
+  return kTRUE;
+}
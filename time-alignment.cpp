@@ -31,10 +31,17 @@
 #include "TMinuit.h"
 #include "TF1.h"
 
-#include "SNM.h"
+#include "INOEventSource.h"
+#include "INOPrefetchingEventSource.h"
+#include "INOCommandLine.h"
 #include "INOEvent.h"
+#include "INOHitDecoder.h"
 #include "INOStorageManager.h"
+#include "INOPixelGeometry.h"
+#include "INODetectorConstants.h"
+#include "INOTracking.h"
 #include "INOTimeGroupingModule.h"
+#include "INOAllocationCounter.h"
 // #include "DynamicHistogram.h"
 #include "INOHelperFunctions.h"
 
@@ -52,11 +59,11 @@ const int        nside         =   2;
 const int        nlayer        =  10;
 const int        nstrip        =  64;
 const int        nTDC          =   8;
-const double     tdc_least     =   0.1;	 // in ns
-const double     stripwidth     =   0.03; // in m
+const double     tdc_least     =   INO::tdcLeast;	 // in ns
+const double     stripwidth     =   INO::stripWidth; // in m
 
 const double     maxtime       =  22.e3;      // in ns
-const double     spdl_mps      =   0.2;	      // m/ns
+const double     spdl_mps      =   INO::stripSignalSpeed; // m/ns
 const double     cval_mpns     =   0.29979;   // light speed in m/ns
 const double     cval_mps      =   0.29979e9; /* light speed in m/s */
 
@@ -66,8 +73,8 @@ const double     ironDensity   = 7.86;	 /* in g/cm3 */
 
 
 const double   gapThickness      = 0.008; // 
-const double   ironThickness     = 0.056; // 
-const double   airGap            = 0.045; //
+const double   ironThickness     = INO::ironThickness; // 
+const double   airGap            = INO::airGap; //
 const double   rpcZShift         = 0; //
 // const double   rpcXdistance      = 2.;	  // 
 // const double   rpcYdistance      = 2.1;	  // 
@@ -85,99 +92,6 @@ int getILayer(const double& layer) {
 };
 
 
-void LinearVectorFit(bool              isTime, // time iter
-                     std::vector<TVector3>  pos,
-                     std::vector<TVector2>  poserr,
-                     std::vector<bool>      occulay,
-                     TVector2         &slope,
-                     TVector2         &inter,
-                     TVector2         &chi2,
-                     std::vector<TVector3> &ext,
-                     std::vector<TVector3> &exterr) {
-  
-  double szxy[nside] = {0};
-  double   sz[nside] = {0};
-  double  sxy[nside] = {0};
-  double   sn[nside] = {0};
-  double  sz2[nside] = {0};
-  
-  double     slp[nside] = {-10000,-10000};
-  double  tmpslp[nside] = {-10000,-10000};
-  double intersect[nside] = {-10000,-10000};
-  double    errcst[nside] = {-10000,-10000};
-  double    errcov[nside] = {-10000,-10000};
-  double    errlin[nside] = {-10000,-10000};
-  
-  for(int ij=0;ij<int(pos.size());ij++) {
-    if(int(occulay.size()) && !occulay[ij]) {continue;}
-    // cout << " ij " << ij << endl;
-    double xyzval[3] = {pos[ij].X(),
-                        pos[ij].Y(),
-                        pos[ij].Z()};
-    double xyerr[2]  = {poserr[ij].X(),
-                        poserr[ij].Y()};
-    for(int nj=0;nj<nside;nj++) {
-      szxy[nj] += xyzval[2]*xyzval[nj]/xyerr[nj];
-      sz[nj]   += xyzval[2]/xyerr[nj];
-      sz2[nj]  += xyzval[2]*xyzval[2]/xyerr[nj];
-      sxy[nj]  += xyzval[nj]/xyerr[nj];
-      sn[nj]   += 1/xyerr[nj];
-    }   // for(int nj=0;nj<nside;nj++) {
-  } // for(int ij=0;ij<int(pos.size());ij++){
-  
-  for(int nj=0;nj<nside;nj++) {
-    if(sn[nj]>0. && sz2[nj]*sn[nj] - sz[nj]*sz[nj] !=0.) { 
-      slp[nj] = (szxy[nj]*sn[nj] -
-                 sz[nj]*sxy[nj])/(sz2[nj]*sn[nj] - sz[nj]*sz[nj]);
-      tmpslp[nj] = slp[nj]; 
-      if(isTime) { //time offset correction
-        // if(fabs((cval*1.e-9)*slope+1)<3.30) { 
-        tmpslp[nj] = -1./cval_mps;
-        // }
-      }
-      intersect[nj] = sxy[nj]/sn[nj] - tmpslp[nj]*sz[nj]/sn[nj];
-
-      double determ = (sn[nj]*sz2[nj] - sz[nj]*sz[nj]);
-      errcst[nj] = sz2[nj]/determ;
-      errcov[nj] = -sz[nj]/determ;
-      errlin[nj] = sn[nj]/determ;
-    }
-  } // for(int nj=0;nj<nside;nj++) {
-  slope.SetX(tmpslp[0]);
-  slope.SetY(tmpslp[1]);
-  inter.SetX(intersect[0]);
-  inter.SetY(intersect[1]);
-  
-  // theta = atan(sqrt(pow(tmpslp[0],2.)+pow(tmpslp[1],2.)));
-  // phi = atan2(tmpslp[1],tmpslp[0]);
-  
-  double sumx = 0, sumy = 0;
-  ext.clear(); exterr.clear();
-  TVector3 xxt;
-  TVector3 xxtt;
-  for(int ij=0;ij<int(pos.size());ij++){
-    xxt.SetX(tmpslp[0]*pos[ij].Z()+intersect[0]);
-    xxt.SetY(tmpslp[1]*pos[ij].Z()+intersect[1]);
-    xxt.SetZ(pos[ij].Z());
-    ext.push_back(xxt);
-    xxtt.SetX(errcst[0] + 2*errcov[0]*pos[ij].Z()+
-              errlin[0]*pos[ij].Z()*pos[ij].Z());
-    xxtt.SetY(errcst[1] + 2*errcov[1]*pos[ij].Z()+
-              errlin[1]*pos[ij].Z()*pos[ij].Z());
-    exterr.push_back(xxtt);
-    // cout << " " << int(exterr.size())
-    // 	 << " " << 1./exterr.back().X()
-    // 	 << " " << 1./exterr.back().Y() << endl;
-    if(int(occulay.size())==0 || occulay[ij]) {
-      sumx += pow(xxt.X()-pos[ij].X(), 2.)/poserr[ij].X(); 
-      sumy += pow(xxt.Y()-pos[ij].Y(), 2.)/poserr[ij].Y(); 
-    }
-  } // for(int ij=0;ij<int(pos.size());ij++){
-  chi2.SetX(sumx);
-  chi2.SetY(sumy);
-};
-
-
 volatile sig_atomic_t stopFlag = 0; // Global flag to detect Ctrl+C
 // Signal handler function
 void signalHandler(int signum) {
@@ -189,7 +103,7 @@ int main(int argc, char** argv) {
 
   /* 
      argv[0]  : main
-     argv[1]  : inputfilename
+     argv[1]  : inputfilename (SNM ROOT file or compact hit file)
      argv[2]  : outputfilename
      argv[3]  : start event
      argv[4]  : end event
@@ -199,6 +113,10 @@ int main(int argc, char** argv) {
      argv[8]  : iteryrow
      argv[9]  : iterlayer
      argv[10] : (empty or additional argument)
+
+     options, anywhere on the command line:
+     --prefetch-depth=N : events read ahead on a background thread (default 8, 0: read on the main thread)
+     --tree-cache-mb=N  : TTreeCache size for SNM input (default 64)
   */
   
   // #ifdef isIter
@@ -208,6 +126,10 @@ int main(int argc, char** argv) {
   //   int iterlayer = stoi(argv[8]);
   // #endif	// #ifdef isIter
 
+  std::map<std::string, std::string> options = INO::takeOptions(argc, argv, {"prefetch-depth", "tree-cache-mb"});
+  int prefetchDepth = INO::getIntOption(options, "prefetch-depth", 8);
+  int treeCacheMB = INO::getIntOption(options, "tree-cache-mb", 64);
+
   // Register signal handler for Ctrl+C
   signal(SIGINT, signalHandler);
 
@@ -240,7 +162,8 @@ int main(int argc, char** argv) {
     O : [the letter o, not a zero] a boolean (Bool_t)
   */
 
-  INO::INOCalibrationManager& inoCalibrationManager = INO::INOCalibrationManager::getInstance();
+  // pixel positions are rotated by the inverse of the layer orientation
+  INO::INOPixelGeometry pixelGeometry(stripwidth, airGap + ironThickness, rpcZShift, true);
 
   // INO::INOStorageManager& inoStorageManager = INO::INOStorageManager::getInstance();
 
@@ -261,30 +184,50 @@ int main(int argc, char** argv) {
   std::map<INO::StripId, TH1D*> stripTimeDelay;
   std::map<INO::SideId, TH1D*> positionResidual;
 
-  TFile* fileIn = new TFile(datafile, "read");
-
-  if(fileIn->IsZombie()) return 0;
-
-  TTree *event_tree = (TTree*)fileIn->Get("SNM");
-  SNM *event = new SNM(event_tree);
-  event->Loop();
+  // SNM ROOT file or compact hit file
+  std::unique_ptr<INO::INOEventSource> eventSource = INO::openEventSource(datafile);
+  if(!eventSource) return 0;
+  // only the first nlayer layers are analysed
+  eventSource->setActiveLayers((1u << nlayer) - 1);
+  eventSource->setCacheSize(int64_t(treeCacheMB) << 20);
+
+  // read ahead on a background thread
+  Long64_t nentry = eventSource->getEntries();
+  INO::INOPrefetchingEventSource* prefetcher = nullptr;
+  if (prefetchDepth > 0) {
+    prefetcher = new INO::INOPrefetchingEventSource(std::move(eventSource), prefetchDepth);
+    eventSource.reset(prefetcher);
+    prefetcher->start(nentrymn, TMath::Min(nentry - 1, nentrymx));
+  }
   
+  // one event and one grouping module are reused for all entries
+  std::shared_ptr<INO::INOEvent> inoEvent = std::make_shared<INO::INOEvent>();
+  std::shared_ptr<INO::INOTimeGroupingModule> inoTimeGrouping = std::make_shared<INO::INOTimeGroupingModule>(inoEvent);
+  // and the arrays of the track fit
+  INO::LineFitBuffer fitPoints;
+  std::vector<TVector3> ext;
+
   Long64_t start_s = clock();
+  uint64_t allocations_s = INO::getThreadAllocationCount();
 
-  Long64_t nentry = event_tree->GetEntries();
   for(Long64_t iev=nentrymn; iev<=TMath::Min(nentry - 1, nentrymx); iev++) {
       
     if(iev%1000==0) {
       Long64_t stop_s = clock();
+      uint64_t allocations = INO::getThreadAllocationCount();
       cout << " iev " << iev
-           << " time " << (stop_s-start_s)/Double_t(CLOCKS_PER_SEC)
+           << " time " << (stop_s-start_s)/Double_t(CLOCKS_PER_SEC);
+      if (INO::isAllocationCounterEnabled)
+        cout << " allocations/event " << (allocations - allocations_s) / 1000.;
+      cout << " input stall " << (prefetcher ? prefetcher->getInputStallSeconds() : 0.)
            << endl;
+      allocations_s = allocations;
     }
   
-    fileIn->cd();
-    event_tree->GetEntry(iev);
+    if (!eventSource->readEntry(iev)) continue;
+    const INO::RawEvent* event = &eventSource->getEvent();
 
-    std::shared_ptr<INO::INOEvent> inoEvent = std::make_shared<INO::INOEvent>();
+    inoEvent->reset();
 
     TTimeStamp eventTime = event->evetime[0];
     inoEvent->setEventTime(eventTime.AsDouble() + (5 * 3600) + (30 * 60));
@@ -295,24 +238,8 @@ int main(int argc, char** argv) {
     //     cout << " time " << eventTime << endl;
     // #endif  // #ifdef isDebug
 
-    // setting rawTDCs
-    for(int ij=0;ij<nlayer;ij++)
-      for(int nj=0;nj<nside;nj++)
-        for (int ntdc = 0; ntdc < 8; ntdc++) {
-          int nTDCHits = event->xythit[nj][ij][ntdc];
-          for (int tc = 0; tc < nTDCHits; tc++) {
-            int rawTDCl = event->xytime[nj][ij][ntdc][tc] * tdc_least;
-            int rawTDCt = rawTDCl + event->plWidth[nj][ij][ntdc][tc] * tdc_least;
-            inoEvent->addTDC(INO::TDCId{0,0,0,ij,nj,ntdc}, rawTDCl, 0);
-            inoEvent->addTDC(INO::TDCId{0,0,0,ij,nj,ntdc}, rawTDCt, 1);
-          }
-        }
-    // setting strip hits
-    for(int ij=0;ij<nlayer;ij++)
-      for(int nj=0;nj<nside;nj++)
-        for(int kl=nstrip-1; kl>=0; kl--)
-          if((event->xydata[nj][ij]>>kl)&0x01)
-            inoEvent->addHit(INO::StripId{0,0,0,ij,nj,kl});
+    // setting rawTDCs and strip hits
+    INO::decodeEvent(*event, *inoEvent, nlayer, tdc_least);
 
     // for (const auto* hit : inoEvent->getHits()) {
     //   INO::StripId stripId = hit->stripId;
@@ -326,12 +253,11 @@ int main(int argc, char** argv) {
     //     constantStripTimeDelay[stripId]->Fill(time);
     // }
 
-    std::shared_ptr<INO::INOTimeGroupingModule> inoTimeGrouping = std::make_shared<INO::INOTimeGroupingModule>(inoEvent);
     // inoTimeGrouping->process();
 
 #ifdef isDebug
-    for (const auto* hit : inoEvent->getHits()) {
-      INO::StripId stripId = hit->stripId;
+    for (const auto& hit : inoEvent->getHitRange()) {
+      INO::StripId stripId = hit.stripId;
       double calibratedTime = inoEvent->getCalibratedLeadingTimes(stripId)[0];
       double low = inoEvent->getLowestCalibratedLeadingTime();
       double high = inoEvent->getHighestCalibratedLeadingTime();
@@ -351,14 +277,14 @@ int main(int argc, char** argv) {
 #endif
 
     std::map<INO::LayerId, int> stripHits[2];
-    for (const auto* hit : inoEvent->getHits()) {
-      INO::StripId stripId = hit->stripId;
+    for (const auto& hit : inoEvent->getHitRange()) {
+      INO::StripId stripId = hit.stripId;
       if(!int(inoEvent->getCalibratedLeadingTimes(stripId).size())) continue;
       if (std::fabs(inoEvent->getCalibratedLeadingTimes(stripId)[0] - expectedEventTime) > triggerWindow * 0.5) continue;
-      stripHits[hit->stripId.side][{hit->stripId.module,
-            hit->stripId.row,
-            hit->stripId.column,
-            hit->stripId.layer}] = hit->stripId.strip;
+      stripHits[hit.stripId.side][{hit.stripId.module,
+            hit.stripId.row,
+            hit.stripId.column,
+            hit.stripId.layer}] = hit.stripId.strip;
     }
     std::vector<INO::PixelId> allPixels;
     for (auto xStripHit : stripHits[0])
@@ -370,54 +296,20 @@ int main(int argc, char** argv) {
                                xStripHit.first.layer,
                                {xStripHit.second, yStripHit.second} });
 
-    std::vector<TVector3>  pos;
-    std::vector<TVector2>  poserr;
-    std::vector<bool>      occulay;
-    TVector2         slope;
-    TVector2         inter;
-    TVector2         chi2;
-    std::vector<TVector3> ext;
-    std::vector<TVector3> exterr;
-    for (auto pixel : allPixels) {
-      TVector3 rawPos = {(pixel.strip[0] + 0.5) * stripwidth,
-                         (pixel.strip[1] + 0.5) * stripwidth,
-                         getLayerZ(pixel.layer)};
-      TVector3 rpcPosition, rpcOrientation;
-      inoCalibrationManager
-        .getLayerPosition({pixel.module, pixel.row, pixel.column,
-                           pixel.layer},
-          pixel.strip[0] < 32 ? 0 : 1,
-          pixel.strip[1] < 32 ? 0 : 1,
-          rpcPosition, rpcOrientation);
-      rpcPosition.SetZ(0);
-      rawPos += rpcPosition;
-      rawPos.RotateX(-rpcOrientation.X() * TMath::DegToRad());
-      rawPos.RotateY(-rpcOrientation.Y() * TMath::DegToRad());
-      rawPos.RotateZ(-rpcOrientation.Z() * TMath::DegToRad());
-      pos.push_back(rawPos);
-      poserr.push_back({0.008, 0.008});
-    }
-    LinearVectorFit(0, pos, poserr, occulay, slope, inter, chi2, ext, exterr);
+    fitPoints.clear();
+    for (auto pixel : allPixels)
+      fitPoints.add(pixelGeometry.getPosition(pixel), 0.008, 0.008);
+    INO::LineFitResult fit;
+    INO::fitLine(0, fitPoints.getPoints(), fit);
+    ext.clear();
+    for (double z : fitPoints.z)
+      ext.emplace_back(fit.getValue(0, z), fit.getValue(1, z), z);
 
     for (auto extHit : ext) {
       int layer = getILayer(extHit.Z());
       for (auto pixel : allPixels) {
         if (layer != pixel.layer) continue;
-        TVector3 rawPos = {(pixel.strip[0] + 0.5) * stripwidth,
-                           (pixel.strip[1] + 0.5) * stripwidth,
-                           getLayerZ(pixel.layer)};
-        TVector3 rpcPosition, rpcOrientation;
-        inoCalibrationManager
-          .getLayerPosition({pixel.module, pixel.row, pixel.column,
-                             pixel.layer},
-            pixel.strip[0] < 32 ? 0 : 1,
-            pixel.strip[1] < 32 ? 0 : 1,
-            rpcPosition, rpcOrientation);
-        rpcPosition.SetZ(0);
-        rawPos += rpcPosition;
-        rawPos.RotateX(-rpcOrientation.X() * TMath::DegToRad());
-        rawPos.RotateY(-rpcOrientation.Y() * TMath::DegToRad());
-        rawPos.RotateZ(-rpcOrientation.Z() * TMath::DegToRad());
+        TVector3 rawPos = pixelGeometry.getPosition(pixel);
         for (int nj : {0, 1}) {
           // position
           INO::SideId sideId = {pixel.module, pixel.row, pixel.column, layer, nj};
@@ -462,7 +354,10 @@ int main(int argc, char** argv) {
     }
 
   } // for(Long64_t iev=nentrymn;iev<nentry;iev++) {
-  fileIn->Close();
+  if (prefetcher)
+    cout << " input stall " << prefetcher->getInputStallSeconds() << " s"
+         << " | read-ahead idle " << prefetcher->getOutputStallSeconds() << " s" << endl;
+  eventSource.reset();
 
   TDirectory* dir = fileOut->mkdir("PositionResidual");
   dir->cd();
@@ -0,0 +1,120 @@
+// Compare the group assignment of the fit-free peak estimators and of the
+// sort-and-sweep engine of INOTimeGroupingModule with the TF1 fit on the
+// same events.
+//
+//   validate-time-grouping <input SNM file> <start event> <end event> [estimator]
+//
+// estimator: 1 = weighted moments, 2 = log-parabola (default), sweep = sort-and-sweep
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <memory>
+#include <string>
+#include <chrono>
+#include <algorithm>
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TMath.h"
+
+#include "SNM.h"
+#include "INOEvent.h"
+#include "INOHitDecoder.h"
+#include "INOTimeGroupingModule.h"
+#include "INODetectorConstants.h"
+
+using namespace std;
+
+
+const int        nlayer        =  10;
+const double     tdc_least     =   INO::tdcLeast;	 // in ns
+
+
+int main(int argc, char** argv) {
+
+  if (argc < 4) {
+    cout << "usage: " << argv[0] << " <input SNM file> <start event> <end event> [estimator]" << endl;
+    return 1;
+  }
+
+  Long64_t nentrymn = stoi(argv[2]);
+  Long64_t nentrymx = stoi(argv[3]);
+  std::string estimator = argc > 4 ? argv[4] : std::to_string(INO::c_logParabola);
+
+  TFile* fileIn = new TFile(argv[1], "read");
+  if(fileIn->IsZombie()) return 0;
+  TTree *event_tree = (TTree*)fileIn->Get("SNM");
+  SNM *event = new SNM(event_tree);
+
+  std::shared_ptr<INO::INOEvent> inoEvent = std::make_shared<INO::INOEvent>();
+  INO::INOTimeGroupingModule reference(inoEvent);
+  INO::INOTimeGroupingModule candidate(inoEvent);
+  INO::TimeGroupingParameters pars = candidate.getParameters();
+  if (estimator == "sweep")
+    pars.groupingEngine = INO::c_sortAndSweep;
+  else
+    pars.peakEstimator = stoi(estimator);
+  candidate.setParameters(pars);
+
+  Long64_t nEvents = 0, nDifferentEvents = 0, nDifferentSignalEvents = 0;
+  Long64_t nStrips = 0, nDifferentStrips = 0, nDifferentSignalStrips = 0;
+  double referenceSeconds = 0, candidateSeconds = 0;
+
+  std::vector<std::vector<int>> referenceGroupIds;
+
+  Long64_t nentry = event_tree->GetEntries();
+  for(Long64_t iev=nentrymn; iev<=TMath::Min(nentry - 1, nentrymx); iev++) {
+
+    event_tree->GetEntry(iev);
+    inoEvent->reset();
+    INO::decodeEvent(*event, *inoEvent, nlayer, tdc_least);
+
+    auto start = std::chrono::steady_clock::now();
+    reference.process();
+    auto middle = std::chrono::steady_clock::now();
+
+    referenceGroupIds.clear();
+    for (const auto& hit : inoEvent->getHitRange())
+      referenceGroupIds.push_back(hit.m_timeGroupId);
+    inoEvent->clearTimeGroups();
+
+    auto restart = std::chrono::steady_clock::now();
+    candidate.process();
+    auto stop = std::chrono::steady_clock::now();
+
+    referenceSeconds += std::chrono::duration<double>(middle - start).count();
+    candidateSeconds += std::chrono::duration<double>(stop - restart).count();
+
+    // compare the full group list and the signal (group 0) membership per strip
+    bool isDifferent = false, isSignalDifferent = false;
+    int ij = 0;
+    for (const auto& hit : inoEvent->getHitRange()) {
+      const auto& groupIds = hit.m_timeGroupId;
+      const auto& referenceIds = referenceGroupIds[ij++];
+      bool isSignal = std::find(groupIds.begin(), groupIds.end(), 0) != groupIds.end();
+      bool isReferenceSignal = std::find(referenceIds.begin(), referenceIds.end(), 0) != referenceIds.end();
+      nStrips++;
+      if (groupIds != referenceIds) { nDifferentStrips++; isDifferent = true; }
+      if (isSignal != isReferenceSignal) { nDifferentSignalStrips++; isSignalDifferent = true; }
+    }
+    nEvents++;
+    if (isDifferent) nDifferentEvents++;
+    if (isSignalDifferent) nDifferentSignalEvents++;
+  }
+  fileIn->Close();
+
+  auto percent = [](Long64_t part, Long64_t total) { return total ? 100. * part / total : 0.; };
+  cout << std::fixed << std::setprecision(3)
+       << "estimator " << estimator << " vs TF1 fit" << endl
+       << " events " << nEvents
+       << " | different group ids " << percent(nDifferentEvents, nEvents) << " %"
+       << " | different signal group " << percent(nDifferentSignalEvents, nEvents) << " %" << endl
+       << " strips " << nStrips
+       << " | different group ids " << percent(nDifferentStrips, nStrips) << " %"
+       << " | different signal group " << percent(nDifferentSignalStrips, nStrips) << " %" << endl
+       << " time/event: fit " << 1.e6 * referenceSeconds / std::max(nEvents, 1LL) << " us"
+       << " | estimator " << 1.e6 * candidateSeconds / std::max(nEvents, 1LL) << " us" << endl;
+
+  return 0;
+}